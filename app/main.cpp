@@ -101,7 +101,7 @@ public:
         pIntSlider->SetViewCells(NRectf(.25f, 1.5, 2.5f, .5f));
         pButton->SetViewCells(NRectf(.25f, 2.0, 2.5f, .5f));
 
-        auto pDecorator = AddDecorator(new NodeDecorator(DecoratorType::Label, "Label"));
+        auto pDecorator = AddDecorator(DecoratorType::Label, "Label");
         pDecorator->gridLocation = NRectf(4, 1, 1, 1);
     }
 
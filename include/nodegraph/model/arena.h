@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace NodeGraph
+{
+
+// A bump allocator.  Objects allocated together sit together in memory, and are released in bulk by Reset.
+// Memory handed back with Free is kept on a list per size and alignment, and reused by the next allocation of
+// that shape, so a graph that keeps creating and deleting nodes doesn't grow.
+// Destructors are not run by the arena; use ArenaDelete (or call them) before the memory goes away.
+// Not thread safe; the graph only allocates while it is being built
+class Arena
+{
+public:
+    explicit Arena(size_t blockSize = 64 * 1024);
+    ~Arena();
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    void* Allocate(size_t size, size_t alignment);
+
+    // Give back one allocation; size and alignment must be the ones it was allocated with
+    void Free(void* p, size_t size, size_t alignment);
+
+    template <class T, typename... Args>
+    T* New(Args&&... args)
+    {
+        return new (Allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    // Give back all the memory at once
+    void Reset();
+
+    size_t GetBytesAllocated() const
+    {
+        return m_bytesAllocated;
+    }
+
+private:
+    struct Block
+    {
+        std::unique_ptr<uint8_t[]> spData;
+        size_t size = 0;
+    };
+    std::vector<Block> m_blocks;
+    size_t m_blockSize;
+    size_t m_used = 0;              // Bytes used in the last block
+    size_t m_bytesAllocated = 0;
+
+    // Freed allocations, keyed by size and alignment; each one holds the pointer to the next
+    std::unordered_map<uint64_t, void*> m_freeLists;
+};
+
+// Deleter for objects living in an Arena; runs the destructor and hands the memory back to the arena.
+// Size and alignment are those of the type allocated, which for a node is the derived type, not Node
+struct ArenaDelete
+{
+    Arena* pArena = nullptr;        // Null leaves the memory until the arena is reset
+    size_t size = 0;
+    size_t alignment = 0;
+
+    ArenaDelete() = default;
+    ArenaDelete(Arena& arena, size_t sz, size_t align)
+        : pArena(&arena),
+        size(sz),
+        alignment(align)
+    {
+    }
+
+    template <class T>
+    void operator()(T* p) const
+    {
+        p->~T();
+        if (pArena)
+        {
+            pArena->Free(p, size, alignment);
+        }
+    }
+};
+
+} // namespace NodeGraph
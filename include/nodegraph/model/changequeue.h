@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "nodegraph/model/parameter.h"
+
+namespace NodeGraph
+{
+
+// A parameter edit made away from the compute thread
+struct ParameterChange
+{
+    Parameter* pParam = nullptr;    // Null once discarded
+    ParameterValue value;           // Set as is; or a double in [0, 1] when normalized
+    bool normalized = false;
+
+    void Apply() const;
+};
+
+// Single producer, single consumer ring of parameter edits.  The UI pushes, and Graph::Compute drains it before
+// it reads anything, so edits never block and never land halfway through a compute.
+// Changes hold the parameter itself, so the compute side discards the ones for parameters it is about to free;
+// Graph::DestroyNode and Graph::Destroy do this for the pins of the nodes they remove
+class ParameterChangeQueue
+{
+public:
+    // Capacity is rounded up to a power of two
+    explicit ParameterChangeQueue(size_t capacity = 1024);
+
+    // Producer side; false (and the change is dropped) if the queue is full
+    bool Push(Parameter& param, const ParameterValue& value);
+    bool PushNormalized(Parameter& param, double value);
+
+    // Consumer side; applies everything pushed so far, returning how many changes were applied
+    size_t Drain();
+
+    // Consumer side; drops the queued changes to parameters that match, so they are never applied
+    template <class Pred>
+    void DiscardIf(Pred pred)
+    {
+        // Slots between the tail and the head are the consumer's until the tail moves
+        auto tail = m_tail.load(std::memory_order_relaxed);
+        auto head = m_head.load(std::memory_order_acquire);
+        for (auto index = tail; index != head; index++)
+        {
+            auto& change = m_entries[index & m_mask];
+            if (change.pParam && pred(*change.pParam))
+            {
+                change.pParam = nullptr;
+            }
+        }
+    }
+
+    // Consumer side; drops everything queued
+    void Clear();
+
+    bool Empty() const
+    {
+        return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+    }
+
+private:
+    bool Push(ParameterChange&& change);
+
+    std::vector<ParameterChange> m_entries;
+    size_t m_mask;
+
+    // Apart, so the two threads don't share a cache line
+    alignas(64) std::atomic<size_t> m_head{ 0 };   // Next slot the producer writes
+    alignas(64) std::atomic<size_t> m_tail{ 0 };   // Next slot the consumer reads
+};
+
+} // namespace NodeGraph
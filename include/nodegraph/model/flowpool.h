@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace NodeGraph
+{
+
+class IFlowData;
+struct ExecutionPlan;
+
+// Makes a flow buffer for a pooled output pin; outputs with the same allocator can share buffers
+using fnCreateFlowData = std::unique_ptr<IFlowData> (*)();
+
+// The allocator for buffers of payload type T
+template <class T>
+std::unique_ptr<IFlowData> CreateFlowData()
+{
+    return std::make_unique<T>();
+}
+
+// Flow buffers owned by the graph.  The plan decides which pooled output writes to which buffer;
+// the pool makes enough of them and points the outputs (and so their readers) at them
+class FlowBufferPool
+{
+public:
+    // Hand out the buffers for a newly built plan; existing buffers are kept, and only grown
+    void Assign(const ExecutionPlan& plan);
+
+    // Number of buffers made so far, of all allocators
+    size_t GetBufferCount() const;
+
+private:
+    std::unordered_map<fnCreateFlowData, std::vector<std::unique_ptr<IFlowData>>> m_buffers;
+};
+
+} // namespace NodeGraph
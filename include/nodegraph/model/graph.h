@@ -1,20 +1,158 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
 #include <cassert>
 #include <exception>
 #include <functional>
-#include <set>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
 
 #include "mutils/profile/profile.h"
 
 #include "threadpool/threadpool.h"
 
+#include "nodegraph/model/changequeue.h"
+#include "nodegraph/model/flowpool.h"
 #include "nodegraph/model/node.h"
+#include "nodegraph/model/parameterbank.h"
 #include "nodegraph/model/pin.h"
+#include "nodegraph/model/plan.h"
+#include "nodegraph/model/scheduler.h"
 
 namespace NodeGraph
 {
 
+// How Graph::Compute walks the execution plan
+enum class ComputeMode
+{
+    Sequential,         // Every node on the calling thread
+    ParallelLevels,     // Each dependency level spread across the thread pool, with a barrier between levels
+    WorkStealing        // Nodes start as soon as their inputs are ready, on whichever pool worker is free
+};
+
+// A view of some of the graph's nodes, as their derived type
+template <class T>
+class NodeRange
+{
+public:
+    class iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = T*;
+        using difference_type = std::ptrdiff_t;
+        using pointer = T**;
+        using reference = T*;
+
+        explicit iterator(std::vector<Node*>::const_iterator itr)
+            : m_itr(itr)
+        {
+        }
+
+        T* operator*() const { return static_cast<T*>(*m_itr); }
+        iterator& operator++() { m_itr++; return *this; }
+        iterator operator++(int) { auto ret = *this; m_itr++; return ret; }
+        bool operator==(const iterator& rhs) const { return m_itr == rhs.m_itr; }
+        bool operator!=(const iterator& rhs) const { return m_itr != rhs.m_itr; }
+
+    private:
+        std::vector<Node*>::const_iterator m_itr;
+    };
+
+    NodeRange()
+    {
+        static const std::vector<Node*> empty;
+        m_pNodes = &empty;
+    }
+
+    explicit NodeRange(const std::vector<Node*>& nodes)
+        : m_pNodes(&nodes)
+    {
+    }
+
+    iterator begin() const { return iterator(m_pNodes->begin()); }
+    iterator end() const { return iterator(m_pNodes->end()); }
+    size_t size() const { return m_pNodes->size(); }
+    bool empty() const { return size() == 0; }
+    T* operator[](size_t index) const { return static_cast<T*>((*m_pNodes)[index]); }
+
+private:
+    const std::vector<Node*>* m_pNodes;
+};
+
+// A view of the nodes of several types, one type's nodes after another; built from the type index slices
+// without copying them
+template <class T, size_t N>
+class NodeJoinRange
+{
+public:
+    using Slices = std::array<const std::vector<Node*>*, N>;
+
+    class iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = T*;
+        using difference_type = std::ptrdiff_t;
+        using pointer = T**;
+        using reference = T*;
+
+        iterator() = default;
+
+        iterator(const Slices* pSlices, size_t slice)
+            : m_pSlices(pSlices)
+            , m_slice(slice)
+        {
+            SkipEmpty();
+        }
+
+        T* operator*() const { return static_cast<T*>((*(*m_pSlices)[m_slice])[m_index]); }
+        iterator& operator++() { m_index++; SkipEmpty(); return *this; }
+        iterator operator++(int) { auto ret = *this; ++*this; return ret; }
+        bool operator==(const iterator& rhs) const { return m_slice == rhs.m_slice && m_index == rhs.m_index; }
+        bool operator!=(const iterator& rhs) const { return !(*this == rhs); }
+
+    private:
+        // Move on to the next slice with nodes left in it, or to the end
+        void SkipEmpty()
+        {
+            while (m_slice < N && m_index == (*m_pSlices)[m_slice]->size())
+            {
+                m_slice++;
+                m_index = 0;
+            }
+        }
+
+        const Slices* m_pSlices = nullptr;
+        size_t m_slice = N;
+        size_t m_index = 0;
+    };
+
+    explicit NodeJoinRange(const Slices& slices)
+        : m_slices(slices)
+    {
+    }
+
+    iterator begin() const { return iterator(&m_slices, 0); }
+    iterator end() const { return iterator(&m_slices, N); }
+    size_t size() const
+    {
+        size_t count = 0;
+        for (auto pNodes : m_slices)
+        {
+            count += pNodes->size();
+        }
+        return count;
+    }
+    bool empty() const { return size() == 0; }
+
+private:
+    Slices m_slices;
+};
+
 // A collection of nodes
 class Graph
 {
@@ -28,58 +166,250 @@ public:
     template <typename T, typename... Args>
     T* CreateNode(Args&&... args)
     {
-        auto pNode = std::make_shared<T>(*this, std::forward<Args>(args)...);
-        nodes.insert(pNode);
-        m_displayNodes.push_back(pNode.get());
-        return pNode.get();
+        // In a fresh arena the node is followed in memory by the pins its constructor makes.  Memory given back
+        // by destroyed nodes and pins is reused first, so a node made after a delete may have its pins apart
+        auto pNode = m_arena.New<T>(*this, std::forward<Args>(args)...);
+        AddNode(std::unique_ptr<Node, ArenaDelete>(pNode, ArenaDelete(m_arena, sizeof(T), alignof(T))));
+        return pNode;
     }
 
-    template <class T>
-    std::set<T*> Find(ctti::type_id_t type) const
+    // Disconnect a node and destroy it; its id will no longer resolve.
+    // Its memory, and its pins', goes back to the arena for the next nodes of the same size to reuse
+    void DestroyNode(Node* pNode);
+
+    // O(1); nullptr if the node has been destroyed
+    Node* GetNode(NodeId id) const
     {
-        std::set<T*> found;
-        for (auto& pNode : nodes)
+        auto index = id & NodeIdIndexMask;
+        if (index >= m_slots.size() || !m_slots[index].spNode || m_slots[index].generation != (id >> NodeIdIndexBits))
         {
-            if (pNode->GetType() == type)
-                found.insert(static_cast<T*>(pNode.get()));
+            return nullptr;
         }
-        return found;
+        return m_slots[index].spNode.get();
     }
 
+    // All nodes of a type; O(1), and doesn't allocate.
+    // The range is invalidated by creating another node of the same type
     template <class T>
-    std::set<T*> Find(const std::vector<ctti::type_id_t>& nodeTypes) const
+    NodeRange<T> Find(ctti::type_id_t type) const
     {
-        std::set<T*> found;
-        for (auto& t : nodeTypes)
+        auto itr = m_typeIndex.find(type.hash());
+        if (itr == m_typeIndex.end())
         {
-            auto f = Find<T>(t);
-            found.insert(f.begin(), f.end());
+            return NodeRange<T>();
         }
-        return found;
+        return NodeRange<T>(itr->second);
     }
 
-    void Visit(Node& node, PinDir dir, ParameterType type, std::function<bool(Node&)> fn);
+    // All nodes of several types, each type's nodes in creation order and each type once, however often
+    // it is listed; doesn't allocate, and is invalidated as the single type Find is
+    template <class T, size_t N>
+    NodeJoinRange<T, N> Find(const ctti::type_id_t (&nodeTypes)[N]) const
+    {
+        static const std::vector<Node*> empty;
+        typename NodeJoinRange<T, N>::Slices slices;
+        for (size_t i = 0; i < N; i++)
+        {
+            slices[i] = &empty;
+
+            // Don't add the same type twice
+            if (std::find(nodeTypes, nodeTypes + i, nodeTypes[i]) != nodeTypes + i)
+            {
+                continue;
+            }
+            auto itr = m_typeIndex.find(nodeTypes[i].hash());
+            if (itr != m_typeIndex.end())
+            {
+                slices[i] = &itr->second;
+            }
+        }
+        return NodeJoinRange<T, N>(slices);
+    }
+
+    // Walk the nodes connected to this one, through inputs (towards sources) or outputs (towards targets)
+    // of the given type (None for any).  Each node is visited once, however many paths reach it;
+    // fn may return false to end the walk early
+    template <typename Fn>
+    void Visit(Node& node, PinDir dir, ParameterType type, Fn&& fn)
+    {
+        // Bitset of visited nodes, by Node::GetIndex
+        std::vector<uint64_t> visited((m_slots.size() + 63) / 64, 0);
+        auto firstVisit = [&](Node& n) {
+            auto& word = visited[n.GetIndex() / 64];
+            auto bit = uint64_t(1) << (n.GetIndex() % 64);
+            auto first = (word & bit) == 0;
+            word |= bit;
+            return first;
+        };
+
+        std::vector<Node*> stack{ &node };
+        firstVisit(node);
+        while (!stack.empty())
+        {
+            auto pNode = stack.back();
+            stack.pop_back();
+
+            if constexpr (std::is_void_v<std::invoke_result_t<Fn, Node&>>)
+            {
+                fn(*pNode);
+            }
+            else if (!fn(*pNode))
+            {
+                return;
+            }
+
+            if (dir == PinDir::Input)
+            {
+                // Reversed, so the first input is the next one off the stack
+                auto& inputs = pNode->GetInputs();
+                for (auto itr = inputs.rbegin(); itr != inputs.rend(); itr++)
+                {
+                    auto pSource = (*itr)->GetSource();
+                    if (pSource && (type == ParameterType::None || type == (*itr)->GetType()))
+                    {
+                        assert(&pSource->GetOwnerNode() != pNode);
+                        if (firstVisit(pSource->GetOwnerNode()))
+                        {
+                            stack.push_back(&pSource->GetOwnerNode());
+                        }
+                    }
+                }
+            }
+            else
+            {
+                for (auto& out : pNode->GetOutputs())
+                {
+                    if (type == ParameterType::None || type == out->GetType())
+                    {
+                        for (auto& pTarget : out->GetTargets())
+                        {
+                            assert(&pTarget->GetOwnerNode() != pNode);
+                            if (firstVisit(pTarget->GetOwnerNode()))
+                            {
+                                stack.push_back(&pTarget->GetOwnerNode());
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
 
     // Get the list of pins that could be on the UI
     std::vector<Pin*> GetControlSurface() const;
 
     void Compute(const std::vector<Node*>& nodes, int64_t numTicks);
 
-    const std::set<std::shared_ptr<Node>>& GetNodes() const { return nodes; }
+    // Compute frames [numTicks, numTicks + frameCount) with a single walk of the plan; each node
+    // gets one Node::ComputeBlock call for the whole block.  A node whose flow is read but that isn't block
+    // aware, and everything downstream of it, is instead computed a frame at a time after the rest, so that
+    // its readers see every frame
+    void ComputeBlock(const std::vector<Node*>& nodes, int64_t numTicks, uint32_t frameCount);
+
+    // Compute what the output nodes need.  Nodes that can't reach an output, and hidden output nodes
+    // that nothing reads, are never visited
+    void ComputeOutputs(int64_t numTicks, uint32_t frameCount = 1);
+
+    // The nodes ComputeOutputs computes, sources first; and how many of the graph's nodes it leaves out
+    const std::vector<Node*>& GetLiveNodes();
+    size_t GetEliminatedCount();
+
+    // Called when nodes or connections change; the next Compute will rebuild its plan
+    void InvalidatePlan() { m_topologyVersion++; }
+    uint64_t GetTopologyVersion() const { return m_topologyVersion; }
+
+    // The evaluation order for the given roots; only rebuilt when the topology or roots change
+    const ExecutionPlan& GetPlan(const std::vector<Node*>& roots);
+
+    // Only compute nodes whose inputs or upstream nodes changed since they last ran
+    void SetIncremental(bool incremental) { m_incremental = incremental; }
+    bool IsIncremental() const { return m_incremental; }
+
+    // Compute pure nodes that have the same type, sources and constant inputs only once; the readers of the others
+    // read the outputs of the first instead.  The nodes and their connections are left as they are.
+    // Duplicates are found when the plan is built; a change to one's constants splits it off, but it (or a node
+    // that was ramping then) is only merged again on the next rebuild
+    void SetMergeDuplicates(bool merge)
+    {
+        m_mergeDuplicates = merge;
+        InvalidatePlan();
+    }
+    bool GetMergeDuplicates() const { return m_mergeDuplicates; }
+
+    void SetComputeMode(ComputeMode mode) { m_computeMode = mode; }
+    ComputeMode GetComputeMode() const { return m_computeMode; }
+
+    // Number of threads (including the caller) that the parallel modes split work across
+    void SetComputeThreads(uint32_t threads) { m_computeThreads = std::max(threads, 1u); }
+    uint32_t GetComputeThreads() const { return m_computeThreads; }
+
+    // All nodes, in creation order
+    const std::vector<Node*>& GetNodes() const { return m_nodes; }
 
     TPool& ThreadPool() { return m_threadPool; }
 
+    // Storage for nodes, pins and decorators; released in bulk by Destroy
+    Arena& GetArena() { return m_arena; }
+
+    // Ramp state for the float and double pins of this graph
+    ParameterBank& GetParameterBank() { return m_parameterBank; }
+
+    // Edits from another thread (the UI); applied at the start of the next compute
+    ParameterChangeQueue& GetChangeQueue() { return m_changes; }
+
+    // Buffers for the pooled flow outputs of planned nodes
+    const FlowBufferPool& GetFlowPool() const { return m_flowPool; }
+
     const std::vector<Node*>& GetDisplayNodes() const { return m_displayNodes; }
     void SetDisplayNodes(const std::vector<Node*>& nodes) { m_displayNodes = nodes; }
    
     const std::vector<Node*>& GetOutputNodes() const { return m_outputNodes; }
     void SetOutputNoes(const std::vector<Node*>& nodes) { m_outputNodes = nodes; }
 protected:
-    std::set<std::shared_ptr<Node>> nodes;
+    void AddNode(std::unique_ptr<Node, ArenaDelete> spNode);
+    bool NeedsCompute(Node& node) const;
+    void ComputeNode(Node& node, int64_t numTicks, uint32_t frameCount);
+    void ComputeBatch(const ExecutionPlan& plan, size_t batch, int64_t numTicks, uint32_t frameCount);
+    void ComputeFolded(const ExecutionPlan& plan, int64_t numTicks, uint32_t frameCount);
+    void FinishFlow(Node& node);
+    void ComputeStepped(const ExecutionPlan& plan, int64_t numTicks, uint32_t frameCount);
+    void ComputeLevels(const ExecutionPlan& plan, int64_t numTicks, uint32_t frameCount);
+
+protected:
+    // Slot map; nodes stay in their slot for life, and freed slots are reused with a new generation
+    Arena m_arena;
+    ParameterBank m_parameterBank;
+    FlowBufferPool m_flowPool;
+    ParameterChangeQueue m_changes;
+
+    struct NodeSlot
+    {
+        std::unique_ptr<Node, ArenaDelete> spNode;
+        uint32_t generation = 1;
+    };
+    std::vector<NodeSlot> m_slots;
+    std::vector<uint32_t> m_freeSlots;
+    std::vector<Node*> m_nodes;
     std::vector<Node*> m_displayNodes;
     uint64_t currentGeneration = 1;
     TPool m_threadPool;
     std::vector<Node*> m_outputNodes;
+    std::unordered_map<uint64_t, std::vector<Node*>> m_typeIndex;   // Nodes by type hash, in creation order
+    uint64_t m_topologyVersion = 1;
+    ExecutionPlan m_plan;
+    WorkStealingScheduler m_scheduler;
+    ComputeMode m_computeMode = ComputeMode::Sequential;
+    uint32_t m_computeThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    bool m_incremental = false;
+    bool m_mergeDuplicates = false;
+    uint64_t m_planGeneration = 0;      // Generation the plan was last rebuilt at; everything is dirty then
+    uint64_t m_foldedStamp = 0;         // InputStamp of the folded nodes' constant inputs, when they last computed
+    bool m_foldedValid = false;
+    std::vector<Node*> m_batchScratch;  // One entry per planned node; incremental batches collect their ready nodes here
+    bool m_stepping = false;            // The plan's stepped nodes are waiting for ComputeStepped
+    std::vector<Node*> m_liveNodes;     // Everything the output nodes read, for the topology and outputs below
+    std::vector<Node*> m_liveOutputs;
+    uint64_t m_liveVersion = 0;
 }; // Graph
 
 } // namespace NodeGraph
@@ -7,7 +7,9 @@
 
 #include <ctti/type_id.hpp>
 
+#include "arena.h"
 #include "pin.h"
+#include "pinschema.h"
 
 struct NVGcontext;
 
@@ -31,8 +33,29 @@ class Node;
 
 constexpr auto str_AutoGen = "auto";
 
+// A node's handle within its graph.  The low bits are the slot the graph stores the node in, the high bits
+// are that slot's generation; it changes when the slot is reused, so a stale id never finds the new node
+using NodeId = uint32_t;
+constexpr NodeId InvalidNodeId = 0;
+constexpr uint32_t NodeIdIndexBits = 20;
+constexpr uint32_t NodeIdIndexMask = (1u << NodeIdIndexBits) - 1;
+constexpr uint32_t NodeIdMaxGeneration = (1u << (32 - NodeIdIndexBits)) - 1;
+
+namespace NodeFlags
+{
+enum
+{
+    None = (0),
+    Volatile = (1 << 0),    // Output can change without any input changing (oscillators, clocks); never skipped
+    Pure = (1 << 1)         // Output depends only on the inputs; folded out of the schedule when they are constant
+};
+}
+
 class Graph;
 
+// Computes several nodes of one type in a single call; see BatchNode
+using fnComputeBatch = void (*)(Node* const* ppNodes, size_t count);
+
 enum class DecoratorType
 {
     Label,
@@ -61,12 +84,7 @@ struct NodeDecorator
 class Node
 {
 public:
-    explicit Node(Graph& m_graph, const std::string& name)
-        : m_strName(name),
-        m_graph(m_graph),
-        m_Id(CurrentId++)
-    {
-    };
+    explicit Node(Graph& m_graph, const std::string& name);
 
     Node(const Node& node) = delete;
     const Node& operator =(const Node& Node) = delete;
@@ -78,8 +96,28 @@ public:
 
     virtual void Compute();
 
+    // Compute frames [tick, tick + frameCount) in one call.  The default steps the input ramps
+    // and calls Compute once per frame; block aware nodes override this and read the per frame
+    // input values with Pin::ValueAt
+    virtual void ComputeBlock(int64_t tick, uint32_t frameCount);
+
+    // True if ComputeBlock is overridden to compute a whole block, and so is also used for single frames.
+    // Other nodes only leave the last frame of a block in their outputs; when their flow is read, they and
+    // everything downstream of them fall back to a plan walk per frame
+    virtual bool IsBlockAware() const { return false; }
+
+    // Non null if nodes of this type can be computed together; the plan groups them within a level
+    virtual fnComputeBatch GetComputeBatch() const { return nullptr; }
+
     // Set
     void SetGeneration(uint64_t gen) { m_generation = gen; }
+    void SetId(NodeId id) { m_Id = id; }
+    void SetFlags(uint32_t flags) { m_flags = flags; }
+
+    // Incremental compute; dirty if an input changed or an upstream node recomputed since our last Compute
+    bool IsDirty() const;
+    void MarkComputed(uint64_t gen);
+    uint64_t GetComputeGeneration() const { return m_computeGeneration; }
 
     // Get
     virtual ctti::type_id_t GetType() const = 0;
@@ -88,6 +126,7 @@ public:
     const std::vector<Pin*>& GetInputs() const { return m_inputs; }
     const std::vector<Pin*>& GetOutputs() const { return m_outputs; }
     const uint64_t GetGeneration() const { return m_generation; }
+    uint32_t GetFlags() const { return m_flags; }
     
     const std::vector<Pin*>& GetControlInputs() const { return m_controlInputs; }
     const std::vector<Pin*>& GetControlOutputs() const { return m_controlOutputs; }
@@ -101,21 +140,48 @@ public:
     template<class T>
     Pin* AddOutput(const std::string& strName, T val, const ParameterAttributes& attrib = ParameterAttributes{})
     {
-        m_outputs.push_back(new Pin(*this, PinDir::Output, strName, val, attrib));
+        m_outputs.push_back(m_arena.New<Pin>(*this, PinDir::Output, strName, val, attrib));
         return m_outputs[m_outputs.size() - 1];
     }
     
     Pin* AddOutput(const std::string& strName, IFlowData* val, const ParameterAttributes& attrib = ParameterAttributes{})
     {
-        auto pPin = new Pin(*this, PinDir::Output, strName, val, attrib);
+        auto pPin = m_arena.New<Pin>(*this, PinDir::Output, strName, val, attrib);
         m_outputs.push_back(pPin);
         m_flowOutputs.push_back(pPin);
         return pPin;
     }
+
+    // A flow output whose buffer comes from the graph's pool; it is null until the node is in a plan
+    Pin* AddOutput(const std::string& strName, fnCreateFlowData fnCreate, const ParameterAttributes& attrib = ParameterAttributes{})
+    {
+        auto pPin = AddOutput(strName, (IFlowData*)nullptr, attrib);
+        pPin->SetFlowAllocator(fnCreate);
+        return pPin;
+    }
+
+    // A flow output that only connects to inputs of the same payload type (or untyped ones); the node sets its data
+    template <class T>
+    FlowPin<T> AddFlowOutput(const std::string& strName)
+    {
+        auto pPin = AddOutput(strName, (IFlowData*)nullptr);
+        pPin->SetFlowType(ctti::type_id<T>().hash());
+        return FlowPin<T>(pPin);
+    }
+
+    // As AddFlowOutput, with a T buffer from the graph's pool.  The allocator comes from the payload type, so the
+    // buffer is always the T that FlowPin reads it as
+    template <class T>
+    FlowPin<T> AddPooledFlowOutput(const std::string& strName)
+    {
+        auto pPin = AddOutput(strName, &CreateFlowData<T>);
+        pPin->SetFlowType(ctti::type_id<T>().hash());
+        return FlowPin<T>(pPin);
+    }
     
     Pin* AddOutput(const std::string& strName, IControlData* val, const ParameterAttributes& attrib = ParameterAttributes{})
     {
-        auto pPin = new Pin(*this, PinDir::Output, strName, val, attrib);
+        auto pPin = m_arena.New<Pin>(*this, PinDir::Output, strName, val, attrib);
         m_outputs.push_back(pPin);
         m_controlOutputs.push_back(pPin);
         return pPin;
@@ -125,13 +191,13 @@ public:
     template<class T>
     Pin* AddInput(const std::string& strName, T val, const ParameterAttributes& attrib = ParameterAttributes{})
     {
-        m_inputs.push_back(new Pin(*this, PinDir::Input, strName, val, attrib));
+        m_inputs.push_back(m_arena.New<Pin>(*this, PinDir::Input, strName, val, attrib));
         return m_inputs[m_inputs.size() - 1];
     }
     
     Pin* AddInput(const std::string& strName, IFlowData* val, const ParameterAttributes& attrib = ParameterAttributes{})
     {
-        auto pPin = new Pin(*this, PinDir::Input, strName, val, attrib);
+        auto pPin = m_arena.New<Pin>(*this, PinDir::Input, strName, val, attrib);
         m_inputs.push_back(pPin);
         m_flowInputs.push_back(pPin);
         return pPin;
@@ -139,16 +205,58 @@ public:
     
     Pin* AddInput(const std::string& strName, IControlData* val, const ParameterAttributes& attrib = ParameterAttributes{})
     {
-        auto pPin = new Pin(*this, PinDir::Input, strName, val, attrib);
+        auto pPin = m_arena.New<Pin>(*this, PinDir::Input, strName, val, attrib);
         m_inputs.push_back(pPin);
         m_controlInputs.push_back(pPin);
         return pPin;
     }
 
+    template <class T>
+    FlowPin<T> AddFlowInput(const std::string& strName)
+    {
+        auto pPin = AddInput(strName, (IFlowData*)nullptr);
+        pPin->SetFlowType(ctti::type_id<T>().hash());
+        return FlowPin<T>(pPin);
+    }
+
+    // Make the pins declared with DECLARE_PINS; before any others, so the schema order is the pin order
+    template <class T>
+    void AddPins()
+    {
+        // Built once per node type; each pin is a copy, sharing the interned attributes
+        static const auto prototypes = []() {
+            std::vector<std::unique_ptr<Parameter>> result;
+            for (auto& spec : T::PinSchema)
+            {
+                result.push_back(MakePinPrototype(spec));
+            }
+            return result;
+        }();
+
+        assert(m_inputs.empty() && m_outputs.empty());
+        for (size_t index = 0; index < prototypes.size(); index++)
+        {
+            AddPin(T::PinSchema[index], *prototypes[index]);
+        }
+        m_pPinNames = T::PinNames.data();
+        m_pinNameCount = T::PinNames.size();
+    }
+
+    Pin* AddPin(const PinSpec& spec, const Parameter& prototype);
+
+    template <typename... Args>
+    NodeDecorator* AddDecorator(DecoratorType type, Args&&... args)
+    {
+        m_decorators.push_back(m_arena.New<NodeDecorator>(type, std::forward<Args>(args)...));
+        return m_decorators.back();
+    }
+
+    // Takes ownership; the decorator is moved in with the rest of the node
     NodeDecorator* AddDecorator(NodeDecorator* decorator)
     {
-        m_decorators.push_back(decorator);
-        return decorator;
+        m_decorators.push_back(m_arena.New<NodeDecorator>(std::move(*decorator)));
+        delete decorator;
+        return m_decorators.back();
     }
 
     const std::vector<NodeDecorator*>& GetDecorators() const
@@ -175,21 +283,27 @@ public:
     virtual void DrawCustomPin(GraphView& view, Canvas& canvas, const MUtils::NRectf&, Pin& pin) { };
 
     bool IsHidden() const { return m_hidden; }
-    void SetHidden(bool hidden) { m_hidden = hidden; }
+    void SetHidden(bool hidden);
 
     Graph& GetGraph() const
     {
         return m_graph;
     }
 
-    uint64_t GetId() const
+    // Resolve with Graph::GetNode
+    NodeId GetId() const
     {
         return m_Id;
     }
 
+    // The slot of this node within its graph
+    uint32_t GetIndex() const
+    {
+        return m_Id & NodeIdIndexMask;
+    }
+
 protected:
-    uint64_t m_Id;
-    static uint64_t CurrentId;
+    NodeId m_Id = InvalidNodeId;
     ctti::type_id_t m_nodeType;
     std::string m_strName;
     std::vector<Pin*> m_inputs;
@@ -200,10 +314,70 @@ protected:
     std::vector<Pin*> m_controlOutputs;
     std::vector<NodeDecorator*> m_decorators;
     uint64_t m_generation = 0;
+    uint64_t m_computeGeneration = 0;   // Graph generation of the last actual Compute
+    uint64_t m_inputStamp = 0;          // Sum of input generations at the last Compute
+    uint32_t m_flags = NodeFlags::None;
     MUtils::NRectf m_viewCells;
     MUtils::NVec2f m_gridScale = MUtils::NVec2f(1.0f);
     bool m_hidden = false;
+    const PinName* m_pPinNames = nullptr;   // The schema's pins, sorted by name; none without a schema
+    size_t m_pinNameCount = 0;
     Graph& m_graph;
+    Arena& m_arena;                     // The graph's arena; pins and decorators live here
+};
+
+// The nodes handed to a batch kernel, as the node type
+template <class T>
+class NodeBatch
+{
+public:
+    NodeBatch(Node* const* ppNodes, size_t count)
+        : m_ppNodes(ppNodes),
+        m_count(count)
+    {
+    }
+
+    T& operator[](size_t index) const
+    {
+        return static_cast<T&>(*m_ppNodes[index]);
+    }
+
+    size_t size() const
+    {
+        return m_count;
+    }
+
+private:
+    Node* const* m_ppNodes;
+    size_t m_count;
+};
+
+// Derive a node type from BatchNode<Type> to have the graph compute it in batches, without a virtual call per node.
+// The type supplies:
+//     static void ComputeBatch(const NodeBatch<Type>& nodes);
+// For graphs with many small nodes of a few types, this keeps the same code hot across a level
+template <class T>
+class BatchNode : public Node
+{
+public:
+    using Node::Node;
+
+    virtual void Compute() override
+    {
+        Node* pThis = this;
+        T::ComputeBatch(NodeBatch<T>(&pThis, 1));
+    }
+
+    virtual fnComputeBatch GetComputeBatch() const override
+    {
+        return &BatchNode::ComputeAll;
+    }
+
+private:
+    static void ComputeAll(Node* const* ppNodes, size_t count)
+    {
+        T::ComputeBatch(NodeBatch<T>(ppNodes, count));
+    }
 };
 
 // A node that has no inputs/outputs or parameters
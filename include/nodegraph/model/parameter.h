@@ -9,6 +9,10 @@
 #include <vector>
 #include <unordered_set>
 #include <functional>
+#include <limits>
+#include <memory>
+
+#include "nodegraph/model/parameterbank.h"
 
 namespace NodeGraph
 {
@@ -82,13 +86,15 @@ struct ParameterValue
         }
     }
 
-    bool operator==(const ParameterValue& val)
+    bool operator==(const ParameterValue& val) const
     {
         if (type != val.type)
             return false;
 
         switch (val.type)
         {
+        case ParameterType::None:
+            return true;
         case ParameterType::Float:
             return fVal == val.fVal;
             break;
@@ -116,6 +122,8 @@ struct ParameterValue
         return false;
     }
 
+    size_t Hash() const;
+
     bool operator==(const float& val)
     {
         if (type != ParameterType::Float)
@@ -505,18 +513,121 @@ struct ParameterAttributes
         origin = (int64_t)_origin;
         step = (int64_t)_step;
     }
+
+    bool operator==(const ParameterAttributes& rhs) const
+    {
+        return ui == rhs.ui && multiSelect == rhs.multiSelect && displayType == rhs.displayType && flags == rhs.flags && taper == rhs.taper && min == rhs.min && max == rhs.max && origin == rhs.origin && step == rhs.step && thumb == rhs.thumb && postFix == rhs.postFix && labels == rhs.labels;
+    }
+
+    size_t Hash() const;
 };
 
-// A parameter is a variant type that can also lerp
+// Interned attribute sets.  Node libraries give thousands of pins the same attributes, so they are stored
+// once and shared; an entry lives as long as a parameter refers to it
+class ParameterAttributeTable
+{
+public:
+    static std::shared_ptr<ParameterAttributes> Intern(const ParameterAttributes& attributes);
+
+    // Number of distinct attribute sets in use
+    static size_t Size();
+};
+
+// The part of a value that compute reads; no string storage, so it stays a single word
+union ParameterScalar
+{
+    float fVal;
+    double dVal;
+    int64_t iVal;
+    bool bVal;
+    IFlowData* pFVal;
+    IControlData* pCVal;
+
+    ParameterScalar()
+        : iVal(0)
+    {
+    }
+};
+
+// Maps a C++ type onto the ParameterType and ParameterScalar member that hold it
+template <class T>
+struct ParameterTraits;
+
+template <>
+struct ParameterTraits<float>
+{
+    static constexpr ParameterType Type = ParameterType::Float;
+    static float& Ref(ParameterScalar& s) { return s.fVal; }
+    static float Get(const ParameterScalar& s) { return s.fVal; }
+};
+
+template <>
+struct ParameterTraits<double>
+{
+    static constexpr ParameterType Type = ParameterType::Double;
+    static double& Ref(ParameterScalar& s) { return s.dVal; }
+    static double Get(const ParameterScalar& s) { return s.dVal; }
+};
+
+template <>
+struct ParameterTraits<int64_t>
+{
+    static constexpr ParameterType Type = ParameterType::Int64;
+    static int64_t& Ref(ParameterScalar& s) { return s.iVal; }
+    static int64_t Get(const ParameterScalar& s) { return s.iVal; }
+};
+
+template <>
+struct ParameterTraits<bool>
+{
+    static constexpr ParameterType Type = ParameterType::Bool;
+    static bool& Ref(ParameterScalar& s) { return s.bVal; }
+    static bool Get(const ParameterScalar& s) { return s.bVal; }
+};
+
+template <>
+struct ParameterTraits<IFlowData*>
+{
+    static constexpr ParameterType Type = ParameterType::FlowData;
+    static IFlowData*& Ref(ParameterScalar& s) { return s.pFVal; }
+    static IFlowData* Get(const ParameterScalar& s) { return s.pFVal; }
+};
+
+template <>
+struct ParameterTraits<IControlData*>
+{
+    static constexpr ParameterType Type = ParameterType::ControlData;
+    static IControlData*& Ref(ParameterScalar& s) { return s.pCVal; }
+    static IControlData* Get(const ParameterScalar& s) { return s.pCVal; }
+};
+
+// Parameter state that compute never touches; only the UI, and setup code
+struct ParameterMetadata
+{
+    ParameterValue initValue;
+    std::shared_ptr<ParameterAttributes> spAttributes;  // Interned, unless this parameter has edited its own copy
+    bool sharedAttributes = true;
+    std::string stringValue;            // Strings don't lerp, so they live here rather than in the hot state
+};
+
+// A parameter is a variant type that can also lerp.
+// The state read and lerped every tick is kept inline and small; the display settings, initial value
+// and string storage are kept out of line, so walking many parameters doesn't drag them through the cache
 class Parameter
 {
 public:
     Parameter()
+        : Parameter(ParameterValue(), ParameterAttributes{})
     {
     }
 
     ~Parameter()
     {
+        if (m_pBank)
+        {
+            m_pBank->Remove(*this);
+        }
+
         // Remove ourselves from the double linked list
         if (m_pNextShadow)
         {
@@ -529,102 +640,101 @@ public:
     }
 
     explicit Parameter(const Parameter& rhs)
-        : m_value(rhs.m_value),
-        m_initValue(rhs.m_initValue),
-        m_attributes(rhs.m_attributes),
-        m_currentTick(rhs.m_currentTick),
-        m_generation(rhs.m_generation),
+        : m_type(rhs.m_type),
+        m_value(rhs.m_value),
+        m_startValue(rhs.m_startValue),
         m_endValue(rhs.m_endValue),
+        m_lerpTicks(rhs.m_lerpTicks),
         m_startTick(rhs.m_startTick),
-        m_lerpTicks(rhs.m_lerpTicks)
+        m_currentTick(rhs.m_currentTick),
+        m_generation(rhs.m_generation),
+        m_spMeta(std::make_unique<ParameterMetadata>(*rhs.m_spMeta))
     {
-
+        // An edited copy of the attributes belongs to rhs alone
+        if (!m_spMeta->sharedAttributes)
+        {
+            m_spMeta->spAttributes = ParameterAttributeTable::Intern(*rhs.m_spMeta->spAttributes);
+            m_spMeta->sharedAttributes = true;
+        }
     }
 
     explicit Parameter(float val, const ParameterAttributes& attrib = ParameterAttributes{})
-        : m_value(val)
-        , m_initValue(val)
-        , m_attributes(attrib)
+        : Parameter(ParameterValue(val), attrib)
     {
         Set(val, true);
     }
 
     explicit Parameter(double val, const ParameterAttributes& attrib = ParameterAttributes{})
-        : m_value(val)
-        , m_initValue(val)
-        , m_attributes(attrib)
+        : Parameter(ParameterValue(val), attrib)
     {
         Set(val, true);
     }
 
     explicit Parameter(int64_t val, const ParameterAttributes& attrib = ParameterAttributes{})
-        : m_value(val)
-        , m_initValue(val)
-        , m_attributes(attrib)
+        : Parameter(ParameterValue(val), attrib)
     {
         Set(val, true);
     }
 
     explicit Parameter(bool val, const ParameterAttributes& attrib = ParameterAttributes{})
-        : m_value(val)
-        , m_initValue(val)
-        , m_attributes(attrib)
+        : Parameter(ParameterValue(val), attrib, ParameterUI::Button)
     {
         Set(val, true);
-        m_attributes.ui = ParameterUI::Button;
     }
 
     explicit Parameter(const std::string& val, const ParameterAttributes& attrib = ParameterAttributes{})
-        : m_value(val)
-        , m_initValue(val)
-        , m_attributes(attrib)
+        : Parameter(ParameterValue(val), attrib, ParameterUI::Text)
     {
         Set(val, true);
-        m_attributes.ui = ParameterUI::Text;
     }
 
     explicit Parameter(IFlowData* val, const ParameterAttributes& attrib = ParameterAttributes{})
-        : m_value(val)
-        , m_initValue(val)
-        , m_attributes(attrib)
+        : Parameter(ParameterValue(val), attrib)
     {
+        m_type = ParameterType::FlowData;
+        m_value.pFVal = m_startValue.pFVal = m_endValue.pFVal = val;
     }
 
     explicit Parameter(IControlData* val, const ParameterAttributes& attrib = ParameterAttributes{})
-        : m_value(val)
-        , m_initValue(val)
-        , m_attributes(attrib)
+        : Parameter(ParameterValue(val), attrib)
     {
+        m_type = ParameterType::ControlData;
+        m_value.pCVal = m_startValue.pCVal = m_endValue.pCVal = val;
     }
 
     void SetAttributes(const ParameterAttributes& attributes)
     {
-        m_attributes = attributes;
+        m_spMeta->spAttributes = ParameterAttributeTable::Intern(attributes);
+        m_spMeta->sharedAttributes = true;
     }
 
+    // For editing; copy on write, so the first edit gives this parameter its own attributes
     ParameterAttributes& GetAttributes()
     {
-        return m_attributes;
+        if (m_spMeta->sharedAttributes)
+        {
+            m_spMeta->spAttributes = std::make_shared<ParameterAttributes>(*m_spMeta->spAttributes);
+            m_spMeta->sharedAttributes = false;
+        }
+        return *m_spMeta->spAttributes;
+    }
+
+    // For reading; never copies
+    const ParameterAttributes& GetAttributes() const
+    {
+        return *m_spMeta->spAttributes;
     }
 
     // Get a value that isn't a flow data
     template <class T>
     T To() const
     {
-        if (m_value.type == ParameterType::FlowData)
-        {
-            throw std::invalid_argument("Can't request flow data with GetValue");
-        }
-        else if (m_value.type == ParameterType::ControlData)
-        {
-            throw std::invalid_argument("Can't request control data with GetValue");
-        }
-        return m_value.To<T>();
+        return ScalarTo<T>(m_type, m_value);
     }
 
     virtual IFlowData* GetFlowData() const
     {
-        if (m_value.type != ParameterType::FlowData)
+        if (m_type != ParameterType::FlowData)
         {
             throw std::invalid_argument("Not flow data!");
         }
@@ -633,98 +743,165 @@ public:
 
     virtual IControlData* GetControlData() const
     {
-        if (m_value.type != ParameterType::ControlData)
+        if (m_type != ParameterType::ControlData)
         {
             throw std::invalid_argument("Not control data!");
         }
         return m_value.pCVal;
     }
 
-    // Update the current value of the parameter
-    ParameterValue Update(uint64_t tick)
+    // The current value, including strings, as a variant
+    ParameterValue GetParameterValue() const
     {
-        m_currentTick = tick;
+        switch (m_type)
+        {
+        case ParameterType::Float:
+            return ParameterValue(m_value.fVal);
+        case ParameterType::Double:
+            return ParameterValue(m_value.dVal);
+        case ParameterType::Int64:
+            return ParameterValue(m_value.iVal);
+        case ParameterType::Bool:
+            return ParameterValue(m_value.bVal);
+        case ParameterType::String:
+            return ParameterValue(m_spMeta->stringValue);
+        case ParameterType::FlowData:
+            return ParameterValue(m_value.pFVal);
+        case ParameterType::ControlData:
+            return ParameterValue(m_value.pCVal);
+        default:
+            break;
+        }
+        return ParameterValue();
+    }
 
-        if (m_endValue == m_value)
+    // True while a Set is still lerping towards its end value
+    bool IsRamping() const
+    {
+        switch (m_type)
         {
-            return m_value;
+        case ParameterType::Float:
+            return m_value.fVal != m_endValue.fVal;
+        case ParameterType::Double:
+            return m_value.dVal != m_endValue.dVal;
+        case ParameterType::Int64:
+            return m_value.iVal != m_endValue.iVal;
+        case ParameterType::Bool:
+            return m_value.bVal != m_endValue.bVal;
+        default:
+            break;
         }
+        return false;
+    }
 
-        m_generation++;
+    // Update the current value of the parameter
+    void Update(uint64_t tick)
+    {
+        m_currentTick = tick;
 
-        if (m_value.type == ParameterType::String || m_value.type == ParameterType::FlowData || m_value.type == ParameterType::ControlData)
+        if (!IsRamping())
         {
-            m_endValue = m_value;
-            return m_value;
+            return;
         }
 
+        m_generation++;
+
         float frac = m_lerpTicks != 0 ? ((float)(tick - m_startTick) / m_lerpTicks) : 1.0f;
         frac = std::min(frac, 1.0f);
         frac = std::max(frac, 0.0f);
-        if (frac <= 1.0f)
+        if (m_type == ParameterType::Float)
         {
-            if (m_value.type == ParameterType::Float)
-            {
-                m_value = m_startValue.fVal + (m_endValue.fVal - m_startValue.fVal) * frac;
-                if (std::abs(m_value.fVal - m_endValue.fVal) <= std::numeric_limits<float>::epsilon())
-                {
-                    m_value = m_endValue;
-                }
-            }
-            else if (m_value.type == ParameterType::Double)
+            m_value.fVal = m_startValue.fVal + (m_endValue.fVal - m_startValue.fVal) * frac;
+            if (std::abs(m_value.fVal - m_endValue.fVal) <= std::numeric_limits<float>::epsilon())
             {
-                m_value = m_startValue.dVal + (m_endValue.dVal - m_startValue.dVal) * frac;
-                if (std::abs(m_value.dVal - m_endValue.dVal) <= std::numeric_limits<float>::epsilon())
-                {
-                    m_value = m_endValue;
-                }
-            }
-            else if (m_value.type == ParameterType::Int64)
-            {
-                m_value = int64_t(m_startValue.iVal + (m_endValue.iVal - m_startValue.iVal) * frac);
+                m_value = m_endValue;
             }
-            else
+        }
+        else if (m_type == ParameterType::Double)
+        {
+            m_value.dVal = m_startValue.dVal + (m_endValue.dVal - m_startValue.dVal) * frac;
+            if (std::abs(m_value.dVal - m_endValue.dVal) <= std::numeric_limits<float>::epsilon())
             {
-                // Can't lerp here.  Might be fun to lerp string ;)
                 m_value = m_endValue;
             }
         }
+        else if (m_type == ParameterType::Int64)
+        {
+            m_value.iVal = int64_t(m_startValue.iVal + (m_endValue.iVal - m_startValue.iVal) * frac);
+        }
+        else
+        {
+            // Can't lerp here.  Might be fun to lerp string ;)
+            m_value = m_endValue;
+        }
+    }
 
-        return m_value;
+    // The value this parameter's ramp has (or will have) at a tick, without advancing it.
+    // Used by block processing to read per frame values
+    template <class T>
+    T ValueAt(int64_t tick) const
+    {
+        if (m_type != ParameterType::Float && m_type != ParameterType::Double && m_type != ParameterType::Int64)
+        {
+            return To<T>();
+        }
+
+        float frac = m_lerpTicks != 0 ? ((float)(tick - m_startTick) / m_lerpTicks) : 1.0f;
+        frac = std::min(frac, 1.0f);
+        frac = std::max(frac, 0.0f);
+
+        if (m_type == ParameterType::Float)
+        {
+            return T(m_startValue.fVal + (m_endValue.fVal - m_startValue.fVal) * frac);
+        }
+        else if (m_type == ParameterType::Double)
+        {
+            return T(m_startValue.dVal + (m_endValue.dVal - m_startValue.dVal) * frac);
+        }
+        return T(int64_t(m_startValue.iVal + (m_endValue.iVal - m_startValue.iVal) * frac));
     }
 
+    // Write the ramp's values for ticks [tick, tick + count), for block processing.
+    // The same values as ValueAt, but vectorized, and a constant fill when there is no ramp
+    void RenderRamp(int64_t tick, float* pValues, uint32_t count) const;
+    void RenderRamp(int64_t tick, double* pValues, uint32_t count) const;
+
     ParameterType GetType() const
     {
-        return m_value.type;
+        return m_type;
     }
 
     void SetLerpSamples(uint64_t lerpTicks)
     {
         m_lerpTicks = lerpTicks;
+        if (m_pBank)
+        {
+            m_pBank->SetRamp(*this);
+        }
     }
 
-    template <class T>
-    inline T To()
+    // True if the graph's parameter bank advances the ramps of this parameter, rather than Update
+    bool IsBanked() const
     {
-        return m_value.To<T>();
+        return m_pBank != nullptr;
     }
 
     template <class T>
     void SetFrom(const T& value)
     {
-        if (m_value.type == ParameterType::Double)
+        if (m_type == ParameterType::Double)
         {
             Set<double>(double(value));
         }
-        else if (m_value.type == ParameterType::Float)
+        else if (m_type == ParameterType::Float)
         {
             Set<float>((float)value);
         }
-        else if (m_value.type == ParameterType::Int64)
+        else if (m_type == ParameterType::Int64)
         {
             Set<int64_t>((int64_t)value);
         }
-        else if (m_value.type == ParameterType::Bool)
+        else if (m_type == ParameterType::Bool)
         {
             Set<bool>(value ? true : false);
         }
@@ -740,6 +917,14 @@ public:
         m_endValue = p.m_endValue;
         m_value = p.m_value;
         m_startTick = p.m_startTick;
+        if (m_type == ParameterType::String)
+        {
+            m_spMeta->stringValue = p.m_spMeta->stringValue;
+        }
+        else if (m_pBank)
+        {
+            m_pBank->SetRamp(*this);
+        }
 
         if (forward)
         {
@@ -777,7 +962,20 @@ public:
     template <class T>
     void Set(const T& val, bool immediate = false)
     {
-        if (m_endValue == val)
+        using Traits = ParameterTraits<T>;
+        if (m_type == ParameterType::None)
+        {
+            // First value fixes the type
+            m_type = Traits::Type;
+            Traits::Ref(m_value) = val;
+            Traits::Ref(m_startValue) = val;
+            Traits::Ref(m_endValue) = val;
+        }
+        else if (m_type != Traits::Type)
+        {
+            throw std::invalid_argument("Parameter type mismatch");
+        }
+        else if (Traits::Ref(m_endValue) == val)
         {
             // No need to update
             return;
@@ -786,42 +984,60 @@ public:
         m_generation++;
 
         // Always immediate
-        if (m_value.type == ParameterType::FlowData || m_value.type == ParameterType::ControlData || m_value.type == ParameterType::String)
+        if (m_type == ParameterType::FlowData || m_type == ParameterType::ControlData)
         {
-            m_value = val;
+            Traits::Ref(m_value) = val;
+            m_startValue = m_endValue = m_value;
         }
         else
         {
-            m_endValue = val;
-            if (immediate)
+            // A zero length ramp has nothing to lerp
+            if (immediate || m_lerpTicks == 0)
             {
-                m_startValue = val;
-                m_value = val;
+                Traits::Ref(m_startValue) = val;
+                Traits::Ref(m_value) = val;
                 m_startTick = 0;
             }
             else
             {
-                if (m_value.type == ParameterType::None)
-                {
-                    m_value = val;
-                }
                 // m_value stays where it is
                 m_startValue = m_value;
-                m_startTick = m_currentTick;
-                m_endValue = val;
+                m_startTick = m_pBank ? m_pBank->GetTick() : m_currentTick;
             }
-        }
+            Traits::Ref(m_endValue) = val;
 
-        // Walk outwards to the shadow variables
-        if (m_pNextShadow)
-        { 
-            m_pNextShadow->SetShadow(*this, true);
+            if (m_pBank)
+            {
+                m_pBank->SetRamp(*this);
+            }
         }
 
-        if (m_pPrevShadow)
+        UpdateShadows();
+    }
+
+    void Set(const std::string& val, bool immediate = false)
+    {
+        if (m_type == ParameterType::None)
         {
-            m_pPrevShadow->SetShadow(*this, false);
+            m_type = ParameterType::String;
+        }
+        else if (m_type != ParameterType::String)
+        {
+            throw std::invalid_argument("Not a string!");
+        }
+        else if (m_spMeta->stringValue == val)
+        {
+            return;
         }
+
+        m_generation++;
+        m_spMeta->stringValue = val;
+        UpdateShadows();
+    }
+
+    void Set(const char* val, bool immediate = false)
+    {
+        Set(std::string(val), immediate);
     }
 
     uint64_t GetGeneration() const
@@ -831,68 +1047,72 @@ public:
 
     const ParameterValue& GetInitValue() const
     {
-        return m_initValue;
+        return m_spMeta->initValue;
     }
 
     // Note can be greater than 1 if the value is out of bounds
     double Normalized()
     {
-        auto min = m_attributes.min.To<double>();
-        auto max = m_attributes.max.To<double>();
+        auto& attributes = *m_spMeta->spAttributes;
+        auto min = attributes.min.To<double>();
+        auto max = attributes.max.To<double>();
 
         double ret;
-        if (m_attributes.taper == 1.0f)
+        if (attributes.taper == 1.0f)
         {
             ret = (To<double>() - min) / (max - min);
         }
         else
         {
-            ret = std::pow(((To<double>() - min) / (max - min)), (1.0 / m_attributes.taper));
+            ret = std::pow(((To<double>() - min) / (max - min)), (1.0 / attributes.taper));
         }
         return std::clamp(ret, 0.0, 1.0);
     }
 
     double NormalizedStep() const
     {
-        auto min = m_attributes.min.To<double>();
-        auto max = m_attributes.max.To<double>();
-        return std::abs(m_attributes.step.To<double>() / (max - min));
+        auto& attributes = *m_spMeta->spAttributes;
+        auto min = attributes.min.To<double>();
+        auto max = attributes.max.To<double>();
+        return std::abs(attributes.step.To<double>() / (max - min));
     }
 
     double NormalizedOrigin() const
     {
-        auto min = m_attributes.min.To<double>();
-        auto max = m_attributes.max.To<double>();
-        auto origin = m_attributes.origin.To<double>();
+        auto& attributes = *m_spMeta->spAttributes;
+        auto min = attributes.min.To<double>();
+        auto max = attributes.max.To<double>();
+        auto origin = attributes.origin.To<double>();
         origin = std::max(origin, min);
 
         double ret;
-        if (m_attributes.taper == 1.0f)
+        if (attributes.taper == 1.0f)
         {
-            ret = ((m_attributes.origin.To<double>() - min) / (max - min));
+            ret = ((attributes.origin.To<double>() - min) / (max - min));
         }
         else
         {
             // Taper == 1 is linear
             auto p = (origin - min) / (max - min);
-            ret = (std::pow(p, (1.0 / (double)m_attributes.taper)));
+            ret = (std::pow(p, (1.0 / (double)attributes.taper)));
         }
         return std::clamp(ret, 0.0, 1.0);
     }
 
     void SetFromNormalized(double val)
     {
-        auto min = m_attributes.min.To<double>();
-        auto max = m_attributes.max.To<double>();
+        auto& attributes = *m_spMeta->spAttributes;
+        auto min = attributes.min.To<double>();
+        auto max = attributes.max.To<double>();
 
         val = std::clamp(val, 0.0, 1.0);
-        if (m_attributes.taper == 1.0f)
+        if (attributes.taper == 1.0f)
         {
             SetFrom<double>(min + (max - min) * val);
         }
 
         // algebraic taper
-        SetFrom<double>(min + (max - min) * std::pow(val, m_attributes.taper));
+        SetFrom<double>(min + (max - min) * std::pow(val, attributes.taper));
     }
 
     void Shadow(Parameter* pParam)
@@ -918,16 +1138,75 @@ public:
         m_pPrevShadow = pEnd;
     }
 
+private:
+    friend class ParameterBank;
+
+    // Common construction; the typed constructors fill in the hot state
+    Parameter(const ParameterValue& initValue, const ParameterAttributes& attrib, ParameterUI ui = ParameterUI::None)
+        : m_spMeta(std::make_unique<ParameterMetadata>())
+    {
+        m_spMeta->initValue = initValue;
+        if (ui == ParameterUI::None)
+        {
+            m_spMeta->spAttributes = ParameterAttributeTable::Intern(attrib);
+        }
+        else
+        {
+            // Some types always use the same UI; intern the attributes with it already set
+            auto attribWithUI = attrib;
+            attribWithUI.ui = ui;
+            m_spMeta->spAttributes = ParameterAttributeTable::Intern(attribWithUI);
+        }
+    }
+
+    // Walk outwards to the shadow variables
+    void UpdateShadows()
+    {
+        if (m_pNextShadow)
+        { 
+            m_pNextShadow->SetShadow(*this, true);
+        }
+
+        if (m_pPrevShadow)
+        {
+            m_pPrevShadow->SetShadow(*this, false);
+        }
+    }
+
 protected:
-    // We lerp between start/end and output value
-    ParameterValue m_value;
-    ParameterValue m_endValue;
-    ParameterValue m_startValue;
+    // Convert a value of the given type; as To
+    template <class T>
+    static T ScalarTo(ParameterType type, const ParameterScalar& value)
+    {
+        switch (type)
+        {
+        case ParameterType::Double:
+            return (T)value.dVal;
+        case ParameterType::Float:
+            return (T)value.fVal;
+        case ParameterType::Int64:
+            return (T)value.iVal;
+        case ParameterType::Bool:
+            return (T)value.bVal;
+        case ParameterType::FlowData:
+            throw std::invalid_argument("Can't request flow data with GetValue");
+        case ParameterType::ControlData:
+            throw std::invalid_argument("Can't request control data with GetValue");
+        default:
+            assert(!"no supported?");
+            break;
+        }
+        T v{};
+        return v;
+    }
 
-    ParameterValue m_initValue;
+    // Hot state, read and lerped by compute
+    ParameterType m_type = ParameterType::None;
 
-    // Settings for how to display
-    ParameterAttributes m_attributes;
+    // We lerp between start/end and output value
+    ParameterScalar m_value;
+    ParameterScalar m_startValue;
+    ParameterScalar m_endValue;
 
     // How many ticks to lerp
     int64_t m_lerpTicks = 0;
@@ -939,10 +1218,17 @@ protected:
     int64_t m_currentTick = 0;
 
     uint64_t m_generation = 0;
-   
+
+    // The graph's bank, which lerps this parameter; and where it sits in the bank while a ramp is in flight
+    ParameterBank* m_pBank = nullptr;
+    uint32_t m_bankSlot = ParameterBank::InactiveSlot;
+
     // Shadow parameters
     Parameter* m_pNextShadow = nullptr;
     Parameter* m_pPrevShadow = nullptr;
+
+    // Cold state; settings for how to display, the initial value
+    std::unique_ptr<ParameterMetadata> m_spMeta;
 };
 
-} // namespace NodeGraph
\ No newline at end of file
+} // namespace NodeGraph
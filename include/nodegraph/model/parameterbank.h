@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace NodeGraph
+{
+
+class Parameter;
+
+// The ramps in flight for the parameters of a graph.
+// A parameter joins when a Set starts a lerp and leaves when it reaches its end value, so a tick costs
+// nothing for the parameters that are idle.  Float and Double ramps are stored as arrays, so that one
+// vectorized pass can advance them all; the others are few, and just call Update.
+// Parameters keep their own copy of the value; the bank writes back only the ones that moved
+class ParameterBank
+{
+public:
+    // The slot of a parameter with no ramp in flight
+    static constexpr uint32_t InactiveSlot = 0xffffffff;
+
+    ParameterBank();
+    ~ParameterBank();
+
+    ParameterBank(const ParameterBank&) = delete;
+    ParameterBank& operator=(const ParameterBank&) = delete;
+
+    // Take over the ramps of a parameter, from now until it is removed.  Parameters must be removed before the bank goes
+    void Add(Parameter& param);
+    void Remove(Parameter& param);
+
+    // Called by the parameter when its ramp changes; safe from compute threads
+    void SetRamp(Parameter& param);
+
+    // Advance every ramp in flight to this tick
+    void Update(int64_t tick);
+
+    int64_t GetTick() const
+    {
+        return m_tick;
+    }
+
+    // Number of ramps in flight
+    size_t GetActiveCount() const
+    {
+        return m_floats.params.size() + m_doubles.params.size() + m_others.size();
+    }
+
+private:
+    // One lane per moving parameter.  The ramp fraction is (tick - startTick) * invLerpTicks, clamped to [0, 1]
+    template <class T>
+    struct Lanes
+    {
+        std::vector<T> start;
+        std::vector<T> end;
+        std::vector<T> current;
+        std::vector<double> startTick;
+        std::vector<double> invLerpTicks;
+        std::vector<Parameter*> params;
+
+        void Resize(size_t size);
+        void Remove(uint32_t slot);
+    };
+
+    template <class T>
+    void Fill(Lanes<T>& lanes, uint32_t slot, Parameter& param);
+
+    template <class T>
+    void Activate(Lanes<T>& lanes, Parameter& param);
+
+    // Write a lane that moved back to its parameter
+    template <class T>
+    static void Scatter(Parameter& param, T value, int64_t tick);
+
+    // Remove the lanes that reached their end value
+    template <class T>
+    void Retire(Lanes<T>& lanes);
+
+    void UpdateFloats(int64_t tick);
+    void UpdateDoubles(int64_t tick);
+    void UpdateOthers(int64_t tick);
+
+private:
+    Lanes<float> m_floats;
+    Lanes<double> m_doubles;
+    std::vector<Parameter*> m_others;       // Int64 and Bool ramps
+    std::vector<uint32_t> m_retired;        // Scratch; lanes done this pass
+    std::mutex m_lock;                      // Nodes may start ramps on their outputs from worker threads
+    int64_t m_tick = 0;
+};
+
+} // namespace NodeGraph
@@ -1,8 +1,12 @@
 #pragma once
 
+#include "nodegraph/model/flowpool.h"
 #include "nodegraph/model/parameter.h"
+#include <atomic>
 #include <cassert>
 #include <cstdint>
+#include <memory>
+#include <type_traits>
 #include <variant>
 #include <unordered_set>
 
@@ -17,6 +21,17 @@ class IFlowData
 {
 public:
     virtual ~IFlowData() {}
+
+    // For Pin::WriteFlowData; data that readers change in place needs both
+    virtual std::unique_ptr<IFlowData> Clone() const
+    {
+        return nullptr;
+    }
+
+    virtual void CopyFrom(const IFlowData&)
+    {
+        throw std::invalid_argument("Flow data can't be copied");
+    }
 };
 
 class IControlData
@@ -56,45 +71,86 @@ public:
         m_pSource = nullptr;
     }
 
+    // Might wind up null, if nothing is connected
     virtual IFlowData* GetFlowData() const override
     {
-        assert(m_value.type == ParameterType::FlowData);
-        if (m_pSource == nullptr)
-        {
-            // might wind up null
-            return Parameter::GetFlowData();
-        }
-        return m_pSource->GetFlowData();
+        assert(m_type == ParameterType::FlowData);
+        return m_pValue->pFVal;
     }
     
-    virtual IControlData* GetControlData() const override
+    // Flow data this input can change.  The source's own data if every other reader of it has already run
+    // in this compute, so the change can't be seen; otherwise a private copy, kept for the next time.
+    // Call it once per compute, before reading; a second call may copy again
+    IFlowData* WriteFlowData();
+
+    // Output pins count the readers still to run in a compute; when it can't be known, every writer copies
+    static constexpr uint32_t SharedReaders = 0xffffffff;
+    void ResetReaders(bool writable) const
+    {
+        m_pendingReaders.store(writable ? uint32_t(GetReaderCount()) : SharedReaders, std::memory_order_relaxed);
+    }
+
+    void ReleaseReader() const
     {
-        assert(m_value.type == ParameterType::ControlData);
-        if (m_pSource == nullptr)
+        if (m_pendingReaders.load(std::memory_order_relaxed) != SharedReaders)
         {
-            // might wind up null
-            return Parameter::GetControlData();
+            m_pendingReaders.fetch_sub(1, std::memory_order_acq_rel);
         }
-        return m_pSource->GetControlData();
     }
 
+    virtual IControlData* GetControlData() const override
+    {
+        assert(m_type == ParameterType::ControlData);
+        return m_pValue->pCVal;
+    }
 
+
+    // The value at the end of the connection, converted to T
     template <typename T>
     T GetValue() const
+    {
+        return ScalarTo<T>(m_type, *m_pValue);
+    }
+
+    // The value at the end of the connection, as a single load; T must be the pin's type.
+    // Connected pins always have the same type, so this is the fastest read for Compute
+    template <typename T>
+    T Value() const
+    {
+        assert(ParameterTraits<T>::Type == m_type);
+        return ParameterTraits<T>::Get(*m_pValue);
+    }
+
+    // Per frame value for block processing; follows the connection like GetValue
+    template <typename T>
+    T ValueAt(int64_t tick) const
     {
         if (!m_pSource)
         {
-            return Parameter::To<T>();
+            return Parameter::ValueAt<T>(tick);
         }
-        else
+        return GetProducer()->ValueAt<T>(tick);
+    }
+
+    // Per frame values for a block; follows the connection like ValueAt
+    void RenderRamp(int64_t tick, float* pValues, uint32_t count) const
+    {
+        if (!m_pSource)
         {
-            return m_pSource->GetValue<T>();
+            Parameter::RenderRamp(tick, pValues, count);
+            return;
         }
+        GetProducer()->RenderRamp(tick, pValues, count);
     }
 
-    ParameterValue& GetParameterValue()
+    void RenderRamp(int64_t tick, double* pValues, uint32_t count) const
     {
-        return m_value;
+        if (!m_pSource)
+        {
+            Parameter::RenderRamp(tick, pValues, count);
+            return;
+        }
+        GetProducer()->RenderRamp(tick, pValues, count);
     }
 
     // Only 1 source can be connected to this pin
@@ -103,6 +159,18 @@ public:
         return m_pSource;
     }
 
+    // The output this input really reads; its source, or the same output of the node the source was merged into
+    const Pin* GetProducer() const
+    {
+        return m_pMergedSource ? m_pMergedSource : m_pSource;
+    }
+
+    // Inputs reading this output, directly or in place of a merged duplicate's output
+    size_t GetReaderCount() const
+    {
+        return m_targets.size() + m_mergedReaders;
+    }
+
     // This pin can connect to multiple targets
     const std::unordered_set<Pin*>& GetTargets() const
     {
@@ -127,6 +195,36 @@ public:
     void SetSource(Pin* pin)
     {
         m_pSource = pin;
+        m_spFlowCopy.reset();
+        Resolve();
+    }
+
+    // Point reads at the value of the pin at the far end of the connection
+    void Resolve()
+    {
+        if (m_pMergedSource)
+        {
+            m_pMergedSource->m_mergedReaders--;
+            m_pMergedSource = nullptr;
+        }
+
+        auto pProducer = this;
+        while (pProducer->m_pSource)
+        {
+            pProducer = pProducer->m_pSource;
+        }
+        m_pValue = &pProducer->m_value;
+    }
+
+    // Read another output, which has the same values as the source's; the plan points the readers of a merged
+    // duplicate at its survivor like this.  Resolve puts it back
+    void ResolveTo(const Pin& output)
+    {
+        assert(m_pSource && output.m_direction == PinDir::Output && output.m_type == m_type);
+        Resolve();
+        m_pMergedSource = &output;
+        output.m_mergedReaders++;
+        m_pValue = &output.m_value;
     }
 
     void AddTarget(Pin* pin)
@@ -154,16 +252,98 @@ public:
         m_viewCells = cells;
     }
 
+    // A flow output with an allocator has its buffer handed out by the graph's pool when the plan is built
+    void SetFlowAllocator(fnCreateFlowData fnCreate)
+    {
+        assert(m_type == ParameterType::FlowData && m_direction == PinDir::Output);
+        m_fnCreateFlow = fnCreate;
+    }
+
+    fnCreateFlowData GetFlowAllocator() const
+    {
+        return m_fnCreateFlow;
+    }
+
+    // This pooled output may share a buffer with the given flow input of the same node.  The plan does it when
+    // this node is the only reader of the input's source, so the node must cope with reading what it writes
+    void SetInPlaceInput(Pin* pInput);
+
+    Pin* GetInPlaceInput() const
+    {
+        return m_pInPlaceInput;
+    }
+
+    // Payload type of a flow pin, as a type hash; 0 takes any payload
+    void SetFlowType(uint64_t flowType)
+    {
+        assert(m_type == ParameterType::FlowData);
+        m_flowType = flowType;
+    }
+
+    uint64_t GetFlowType() const
+    {
+        return m_flowType;
+    }
+
+    // For an input: a typed one only takes the same payload, since FlowPin reads it without a check.
+    // An untyped input reads raw flow data, and takes anything
+    bool AcceptsFlowFrom(const Pin& output) const
+    {
+        return m_flowType == 0 || m_flowType == output.m_flowType;
+    }
+
 private:
+    // Read during compute; kept next to the parameter's hot state
+    Pin* m_pSource = nullptr;               // Which pin I'm connected from
+    const ParameterScalar* m_pValue = &m_value; // Where reads come from; the source's value, or our own
+    const Pin* m_pMergedSource = nullptr;   // Output read instead of the source's, while the source is merged away
+    Node& m_owner;                          // Node that owns this pin
     PinDir m_direction;                     // The direction of this pin
+
+    // Connection editing and UI only
     std::string m_strName;                  // The name of this pin
+    std::unordered_set<Pin*> m_targets;     // Which pins I'm connected to
+    MUtils::NRectf m_viewCells = MUtils::NRectf(0, 0, 0, 0);            // Cells that this parameter should be shown in for UI
+    fnCreateFlowData m_fnCreateFlow = nullptr;  // Makes this output's buffer, if the graph pools it
+    Pin* m_pInPlaceInput = nullptr;             // Input this output may write over
+    uint64_t m_flowType = 0;                    // Hash of the payload type, for typed flow pins
+    mutable std::atomic<uint32_t> m_pendingReaders{ SharedReaders }; // Readers of this output yet to run
+    mutable uint32_t m_mergedReaders = 0;       // Inputs resolved to this output in place of a duplicate's
+    std::unique_ptr<IFlowData> m_spFlowCopy;    // This input's copy of its source, for WriteFlowData
+};
 
-    Node& m_owner;                          // Node that owns this pin
+// A view of a flow pin with a payload type.  The type is tagged on the pin when it is made, and checked once
+// by Node::ConnectTo, so reads in Compute are a plain cast of the resolved pointer
+template <class T>
+class FlowPin
+{
+public:
+    static_assert(std::is_base_of_v<IFlowData, T>, "Flow payloads derive from IFlowData");
 
-    std::unordered_set<Pin*> m_targets;     // Which pins I'm connected to
-    Pin* m_pSource = nullptr;               // Which pin I'm connected from
+    explicit FlowPin(Pin* pPin = nullptr)
+        : m_pPin(pPin)
+    {
+    }
 
-    MUtils::NRectf m_viewCells = MUtils::NRectf(0, 0, 0, 0);            // Cells that this parameter should be shown in for UI
+    Pin* GetPin() const
+    {
+        return m_pPin;
+    }
+
+    // The data at the far end of the connection; may be null
+    T* Read() const
+    {
+        return static_cast<T*>(m_pPin->GetFlowData());
+    }
+
+    // As Pin::WriteFlowData
+    T* Write() const
+    {
+        return static_cast<T*>(m_pPin->WriteFlowData());
+    }
+
+private:
+    Pin* m_pPin;
 };
 
 
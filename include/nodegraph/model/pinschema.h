@@ -0,0 +1,167 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <memory>
+
+#include "nodegraph/model/parameter.h"
+#include "nodegraph/model/pin.h"
+
+namespace NodeGraph
+{
+
+// One pin of a node type, declared at compile time with DECLARE_PINS
+struct PinSpec
+{
+    PinDir direction;
+    const char* name;
+    ParameterType type;
+    double value = 0.0;                 // Initial value, for the scalar types
+    ParameterUI ui = ParameterUI::None;
+    double min = 0.0;                   // Range, when there is a UI
+    double max = 1.0;
+};
+
+constexpr PinSpec InputPin(const char* name, ParameterType type, double value = 0.0, ParameterUI ui = ParameterUI::None, double min = 0.0, double max = 1.0)
+{
+    return PinSpec{ PinDir::Input, name, type, value, ui, min, max };
+}
+
+constexpr PinSpec OutputPin(const char* name, ParameterType type, double value = 0.0, ParameterUI ui = ParameterUI::None, double min = 0.0, double max = 1.0)
+{
+    return PinSpec{ PinDir::Output, name, type, value, ui, min, max };
+}
+
+// The C++ type a schema pin holds
+template <ParameterType Type>
+struct PinValueType;
+
+template <>
+struct PinValueType<ParameterType::Float>
+{
+    using Type = float;
+};
+
+template <>
+struct PinValueType<ParameterType::Double>
+{
+    using Type = double;
+};
+
+template <>
+struct PinValueType<ParameterType::Int64>
+{
+    using Type = int64_t;
+};
+
+template <>
+struct PinValueType<ParameterType::Bool>
+{
+    using Type = bool;
+};
+
+template <>
+struct PinValueType<ParameterType::FlowData>
+{
+    using Type = IFlowData*;
+};
+
+template <>
+struct PinValueType<ParameterType::ControlData>
+{
+    using Type = IControlData*;
+};
+
+// Where a schema pin lands in the node's inputs or outputs
+template <size_t N>
+constexpr size_t PinSchemaSlot(const PinSpec (&schema)[N], size_t index)
+{
+    size_t slot = 0;
+    for (size_t i = 0; i < index; i++)
+    {
+        if (schema[i].direction == schema[index].direction)
+        {
+            slot++;
+        }
+    }
+    return slot;
+}
+
+// A schema pin by name.  DECLARE_PINS sorts them at compile time, so Node::GetPin finds a name by binary search
+struct PinName
+{
+    const char* name = nullptr;
+    PinDir direction = PinDir::Input;
+    size_t slot = 0;
+};
+
+// Byte order, as std::string::compare
+constexpr int ComparePinNames(const char* pLeft, const char* pRight)
+{
+    while (*pLeft != 0 && *pLeft == *pRight)
+    {
+        pLeft++;
+        pRight++;
+    }
+    return int(static_cast<unsigned char>(*pLeft)) - int(static_cast<unsigned char>(*pRight));
+}
+
+template <size_t N>
+constexpr std::array<PinName, N> MakePinNames(const PinSpec (&schema)[N])
+{
+    // Insertion sort; schemas are short
+    std::array<PinName, N> names{};
+    for (size_t index = 0; index < N; index++)
+    {
+        PinName entry{ schema[index].name, schema[index].direction, PinSchemaSlot(schema, index) };
+        size_t pos = index;
+        while (pos > 0 && ComparePinNames(entry.name, names[pos - 1].name) < 0)
+        {
+            names[pos] = names[pos - 1];
+            pos--;
+        }
+        names[pos] = entry;
+    }
+    return names;
+}
+
+// A parameter with the spec's type, value and attributes; pins of the type are copied from it
+std::unique_ptr<Parameter> MakePinPrototype(const PinSpec& spec);
+
+} // namespace NodeGraph
+
+// Declare a node's pins at compile time; call AddPins<Type>() first thing in the constructor.
+// Gives typed access to pin I of the schema, with no lookup:
+//     PinAt<I>(), Read<I>(), Write<I>(value)
+// Index the pins with an enum that follows the schema order
+#define DECLARE_PINS(...)                                                                                   \
+    static constexpr NodeGraph::PinSpec PinSchema[] = { __VA_ARGS__ };                                      \
+    static constexpr auto PinNames = NodeGraph::MakePinNames(PinSchema);                                    \
+    template <size_t I>                                                                                     \
+    NodeGraph::Pin* PinAt() const                                                                           \
+    {                                                                                                       \
+        static_assert(I < sizeof(PinSchema) / sizeof(PinSchema[0]), "No such pin in the schema");          \
+        constexpr auto slot = NodeGraph::PinSchemaSlot(PinSchema, I);                                       \
+        if constexpr (PinSchema[I].direction == NodeGraph::PinDir::Input)                                   \
+        {                                                                                                   \
+            return m_inputs[slot];                                                                          \
+        }                                                                                                   \
+        else                                                                                                \
+        {                                                                                                   \
+            return m_outputs[slot];                                                                         \
+        }                                                                                                   \
+    }                                                                                                       \
+    template <size_t I>                                                                                     \
+    typename NodeGraph::PinValueType<PinSchema[I].type>::Type Read() const                                  \
+    {                                                                                                       \
+        return PinAt<I>()->template Value<typename NodeGraph::PinValueType<PinSchema[I].type>::Type>();     \
+    }                                                                                                       \
+    template <size_t I>                                                                                     \
+    void Write(const typename NodeGraph::PinValueType<PinSchema[I].type>::Type& value)                     \
+    {                                                                                                       \
+        PinAt<I>()->Set(value);                                                                             \
+    }
+
+#define DECLARE_NODE_PINS(className, APIName, ...) \
+    DECLARE_NODE(className, APIName)               \
+    DECLARE_PINS(__VA_ARGS__)
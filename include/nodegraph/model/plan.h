@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "flowpool.h"
+
+namespace NodeGraph
+{
+
+class Node;
+class Pin;
+
+// A flattened evaluation order for a set of root nodes.
+// The graph builds this once and reuses it until the topology changes, so a compute tick
+// is a linear walk instead of a recursive pull through the node inputs.
+struct ExecutionPlan
+{
+    std::vector<Node*> roots;           // The nodes this plan was built for
+    std::vector<Node*> nodes;           // Topologically sorted; sources come before the nodes that read them
+    std::vector<size_t> levelStarts;    // Nodes are grouped by dependency level; level i is [levelStarts[i], levelStarts[i + 1])
+
+    // Within a level, nodes of a type with a batch kernel sit together, so they can be computed in one call.
+    // Batch i is [batchStarts[i], batchStarts[i + 1]); level i holds batches [levelBatches[i], levelBatches[i + 1])
+    std::vector<size_t> batchStarts;
+    std::vector<size_t> levelBatches;
+
+    // Dependency edges, by index into nodes.  Node i waits on dependencyCounts[i] inputs,
+    // and feeds the nodes in successors[successorStarts[i] .. successorStarts[i + 1])
+    std::vector<uint32_t> dependencyCounts;
+    std::vector<uint32_t> successorStarts;
+    std::vector<uint32_t> successors;
+    uint64_t topologyVersion = 0;       // The graph topology this plan is valid for
+
+    // Nodes that compute a block a frame at a time, after the rest: the ones whose flows are read but aren't block
+    // aware, and everything downstream of them.  In plan order; stepped[node->GetIndex()] is set for each
+    std::vector<Node*> steppedNodes;
+    std::vector<uint8_t> stepped;
+
+    // Pure nodes whose inputs are all constant, or come from other folded nodes.  They are not in nodes;
+    // the graph computes them (in this order) only when one of the constant inputs changes
+    std::vector<Node*> folded;
+    std::vector<const Pin*> foldedInputs;
+
+    // Duplicate pure nodes, merged when asked for: same type, same sources, same constants.  Only the first
+    // is computed; duplicates[survivor->GetIndex()] lists the nodes whose readers read its outputs instead
+    std::vector<std::vector<Node*>> duplicates;
+    std::vector<Pin*> mergedReaders;    // Those readers; resolved to the survivor's outputs until the merge ends
+
+    // What each merge relies on: the constants of both nodes, as they were, and the merged nodes they read
+    struct Merge
+    {
+        Node* pSurvivor;
+        Node* pDuplicate;
+        std::vector<const Pin*> inputs;
+        uint64_t stamp;                 // InputStamp of inputs
+        std::vector<Node*> via;
+    };
+    std::vector<Merge> merges;
+
+    // Pooled flow outputs of the scheduled and folded nodes, and the buffer each writes to; numbered per allocator.
+    // With reuse, a buffer moves on to a later level once every reader of its last output has run
+    struct FlowBuffer
+    {
+        Pin* pOutput;
+        fnCreateFlowData fnCreate;
+        uint32_t buffer;
+    };
+    std::vector<FlowBuffer> flowBuffers;
+    bool reuseFlowBuffers = false;
+
+    size_t LevelCount() const
+    {
+        return levelStarts.empty() ? 0 : levelStarts.size() - 1;
+    }
+
+    size_t BatchCount() const
+    {
+        return batchStarts.empty() ? 0 : batchStarts.size() - 1;
+    }
+};
+
+// Returns true if the evaluator must compute the source of this input pin first
+bool IsDependencyPin(const Pin& pin);
+
+// Sum of the generations of the inputs, and of the outputs they read; it changes whenever one of them does
+uint64_t InputStamp(const std::vector<Pin*>& inputs);
+uint64_t InputStamp(const std::vector<const Pin*>& inputs);
+
+// Put back the duplicates whose constants, or their survivor's, changed since they were merged; along with the
+// ones merged because they read them.  Only they are added to the schedule; true if there were any
+bool SplitDuplicates(ExecutionPlan& plan);
+
+// Point the readers of merged nodes back at their own sources.  A rebuild does this first; so must anything
+// that destroys a node while the plan's readers are still alive
+void RestoreMergedReaders(ExecutionPlan& plan);
+
+// Build the evaluation order for all nodes needed to compute the roots
+void BuildExecutionPlan(ExecutionPlan& plan, const std::vector<Node*>& roots, uint64_t topologyVersion, bool mergeDuplicates = false, bool reuseFlowBuffers = false);
+
+} // namespace NodeGraph
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "threadpool/threadpool.h"
+
+namespace NodeGraph
+{
+
+class Node;
+struct ExecutionPlan;
+
+// Runs an execution plan as a dependency graph instead of level by level.
+// Every node has an atomic count of the inputs still being produced; the worker that finishes
+// the last producer pushes the node onto its own deque, and idle workers steal from the others.
+// Long chains and short branches therefore overlap, instead of waiting on the slowest node in a level.
+class WorkStealingScheduler
+{
+public:
+    using fnCompute = std::function<void(Node&)>;
+
+    WorkStealingScheduler();
+    ~WorkStealingScheduler();
+
+    // Compute every node in the plan, using the caller plus (threads - 1) pool workers
+    void Run(const ExecutionPlan& plan, TPool& pool, uint32_t threads, const fnCompute& fn);
+
+private:
+    class WorkDeque;
+
+    void Prepare(const ExecutionPlan& plan, uint32_t threads);
+    void WorkerLoop(uint32_t worker, const ExecutionPlan& plan, const fnCompute& fn);
+    bool Acquire(uint32_t worker, uint32_t& index);
+
+private:
+    std::unique_ptr<std::atomic<uint32_t>[]> m_pendingInputs;  // Per plan node; inputs not yet produced this run
+    size_t m_pendingCapacity = 0;
+    std::vector<std::unique_ptr<WorkDeque>> m_deques;           // One per worker
+    uint32_t m_workerCount = 0;                                 // Workers taking part in the current run
+    std::atomic<size_t> m_remaining{ 0 };                       // Nodes not yet computed this run
+    std::atomic<uint32_t> m_runningWorkers{ 0 };                // Pool workers that haven't returned yet
+    std::atomic<bool> m_abort{ false };
+    std::exception_ptr m_spException;
+    std::mutex m_exceptionLock;
+};
+
+} // namespace NodeGraph
@@ -0,0 +1,93 @@
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#include "nodegraph/model/arena.h"
+
+namespace NodeGraph
+{
+
+namespace
+{
+uint64_t FreeListKey(size_t size, size_t alignment)
+{
+    // Alignments are powers of two well below 256
+    return (uint64_t(size) << 8) | uint64_t(alignment);
+}
+} // namespace
+
+Arena::Arena(size_t blockSize)
+    : m_blockSize(blockSize)
+{
+}
+
+Arena::~Arena()
+{
+    Reset();
+}
+
+void* Arena::Allocate(size_t size, size_t alignment)
+{
+    assert(alignment != 0 && (alignment & (alignment - 1)) == 0);
+
+    // Reuse memory of the same shape before bumping
+    if (size >= sizeof(void*))
+    {
+        auto itr = m_freeLists.find(FreeListKey(size, alignment));
+        if (itr != m_freeLists.end() && itr->second)
+        {
+            auto p = itr->second;
+            std::memcpy(&itr->second, p, sizeof(void*));
+            m_bytesAllocated += size;
+            return p;
+        }
+    }
+
+    if (!m_blocks.empty())
+    {
+        auto& block = m_blocks.back();
+        auto base = reinterpret_cast<uintptr_t>(block.spData.get());
+        auto offset = ((base + m_used + alignment - 1) & ~(uintptr_t(alignment) - 1)) - base;
+        if (offset + size <= block.size)
+        {
+            m_used = offset + size;
+            m_bytesAllocated += size;
+            return block.spData.get() + offset;
+        }
+    }
+
+    // Oversized allocations get a block to themselves
+    Block block;
+    block.size = std::max(m_blockSize, size + alignment);
+    block.spData.reset(new uint8_t[block.size]);
+    m_blocks.push_back(std::move(block));
+    m_used = 0;
+    return Allocate(size, alignment);
+}
+
+void Arena::Free(void* p, size_t size, size_t alignment)
+{
+    assert(alignment < 256);
+    assert(m_bytesAllocated >= size);
+    m_bytesAllocated -= size;
+
+    // Too small to hold the link; it stays put until the reset
+    if (size < sizeof(void*))
+    {
+        return;
+    }
+
+    auto& head = m_freeLists[FreeListKey(size, alignment)];
+    std::memcpy(p, &head, sizeof(void*));
+    head = p;
+}
+
+void Arena::Reset()
+{
+    m_freeLists.clear();
+    m_blocks.clear();
+    m_used = 0;
+    m_bytesAllocated = 0;
+}
+
+} // namespace NodeGraph
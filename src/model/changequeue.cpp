@@ -0,0 +1,104 @@
+#include "nodegraph/model/changequeue.h"
+
+namespace NodeGraph
+{
+
+void ParameterChange::Apply() const
+{
+    if (normalized)
+    {
+        pParam->SetFromNormalized(value.To<double>());
+        return;
+    }
+
+    switch (value.type)
+    {
+    case ParameterType::Float:
+        pParam->SetFrom<float>(value.fVal);
+        break;
+    case ParameterType::Double:
+        pParam->SetFrom<double>(value.dVal);
+        break;
+    case ParameterType::Int64:
+        pParam->SetFrom<int64_t>(value.iVal);
+        break;
+    case ParameterType::Bool:
+        pParam->SetFrom<bool>(value.bVal);
+        break;
+    case ParameterType::String:
+        pParam->Set(value.sVal);
+        break;
+    default:
+        assert(!"Only values can be queued");
+        break;
+    }
+}
+
+ParameterChangeQueue::ParameterChangeQueue(size_t capacity)
+{
+    size_t size = 1;
+    while (size < capacity)
+    {
+        size <<= 1;
+    }
+    m_entries.resize(size);
+    m_mask = size - 1;
+}
+
+bool ParameterChangeQueue::Push(Parameter& param, const ParameterValue& value)
+{
+    ParameterChange change;
+    change.pParam = &param;
+    change.value = value;
+    return Push(std::move(change));
+}
+
+bool ParameterChangeQueue::PushNormalized(Parameter& param, double value)
+{
+    ParameterChange change;
+    change.pParam = &param;
+    change.value = ParameterValue(value);
+    change.normalized = true;
+    return Push(std::move(change));
+}
+
+bool ParameterChangeQueue::Push(ParameterChange&& change)
+{
+    auto head = m_head.load(std::memory_order_relaxed);
+    if (head - m_tail.load(std::memory_order_acquire) == m_entries.size())
+    {
+        return false;
+    }
+
+    // The slot is ours until the head moves past it
+    m_entries[head & m_mask] = std::move(change);
+    m_head.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+size_t ParameterChangeQueue::Drain()
+{
+    auto tail = m_tail.load(std::memory_order_relaxed);
+    auto head = m_head.load(std::memory_order_acquire);
+    size_t applied = 0;
+    for (auto index = tail; index != head; index++)
+    {
+        auto& change = m_entries[index & m_mask];
+        if (change.pParam)
+        {
+            change.Apply();
+            applied++;
+        }
+    }
+
+    // Hand the slots back
+    m_tail.store(head, std::memory_order_release);
+    return applied;
+}
+
+void ParameterChangeQueue::Clear()
+{
+    m_tail.store(m_head.load(std::memory_order_acquire), std::memory_order_release);
+}
+
+} // namespace NodeGraph
@@ -0,0 +1,33 @@
+#include "nodegraph/model/flowpool.h"
+#include "nodegraph/model/pin.h"
+#include "nodegraph/model/plan.h"
+
+namespace NodeGraph
+{
+
+void FlowBufferPool::Assign(const ExecutionPlan& plan)
+{
+    for (auto& flow : plan.flowBuffers)
+    {
+        auto& buffers = m_buffers[flow.fnCreate];
+        while (buffers.size() <= flow.buffer)
+        {
+            buffers.push_back(flow.fnCreate());
+        }
+
+        // Readers resolve to the output's value, so they follow it to the new buffer
+        flow.pOutput->Set(buffers[flow.buffer].get(), true);
+    }
+}
+
+size_t FlowBufferPool::GetBufferCount() const
+{
+    size_t count = 0;
+    for (auto& entry : m_buffers)
+    {
+        count += entry.second.size();
+    }
+    return count;
+}
+
+} // namespace NodeGraph
@@ -1,4 +1,7 @@
+#include <algorithm>
+#include <atomic>
 #include <exception>
+#include <mutex>
 #include <stdexcept>
 
 #include "mutils/logger/logger.h"
@@ -22,110 +25,483 @@ Graph::~Graph()
 
 void Graph::Destroy()
 {
-    nodes.clear();
+    m_plan = ExecutionPlan{};
+    InvalidatePlan();
+
+    // Queued edits point at pins that are about to go
+    m_changes.Clear();
+    m_typeIndex.clear();
+    m_displayNodes.clear();
+    m_outputNodes.clear();
+    m_nodes.clear();
+
+    // Keep the slots, so that ids from before the destroy stay invalid
+    m_freeSlots.clear();
+    for (uint32_t index = uint32_t(m_slots.size()); index > 0; index--)
+    {
+        auto& slot = m_slots[index - 1];
+        if (slot.spNode)
+        {
+            slot.spNode.reset();
+            slot.generation = slot.generation == NodeIdMaxGeneration ? 1 : slot.generation + 1;
+        }
+        m_freeSlots.push_back(index - 1);
+    }
+
+    // Every node is gone, so all of their memory can go in one go
+    m_arena.Reset();
 }
 
-void Graph::Visit(Node& node, PinDir dir, ParameterType type, std::function<bool(Node&)> fn)
+void Graph::AddNode(std::unique_ptr<Node, ArenaDelete> spNode)
 {
-    fn(node);
+    uint32_t index;
+    if (!m_freeSlots.empty())
+    {
+        index = m_freeSlots.back();
+        m_freeSlots.pop_back();
+    }
+    else
+    {
+        if (m_slots.size() > NodeIdIndexMask)
+        {
+            throw std::out_of_range("Too many nodes in graph");
+        }
+        index = uint32_t(m_slots.size());
+        m_slots.emplace_back();
+    }
+
+    auto& slot = m_slots[index];
+    spNode->SetId((slot.generation << NodeIdIndexBits) | index);
 
-    if (dir == PinDir::Input)
+    m_nodes.push_back(spNode.get());
+    m_typeIndex[spNode->GetType().hash()].push_back(spNode.get());
+    m_displayNodes.push_back(spNode.get());
+    slot.spNode = std::move(spNode);
+    InvalidatePlan();
+}
+
+void Graph::DestroyNode(Node* pNode)
+{
+    if (GetNode(pNode->GetId()) != pNode)
     {
-        for (auto& in : node.GetInputs())
+        throw std::invalid_argument("Node is not in this graph");
+    }
+
+    // Merged readers may read its outputs, or be its inputs; put them back while they all still exist
+    RestoreMergedReaders(m_plan);
+
+    // Cut all the connections to and from it
+    for (auto& pIn : pNode->GetInputs())
+    {
+        if (pIn->GetSource())
         {
-            if (type == ParameterType::None || type == in->GetType())
-            {
-                auto pSource = in->GetSource();
-                if (pSource)
-                {
-                    assert(&pSource->GetOwnerNode() != &node);
-                    Visit(pSource->GetOwnerNode(), dir, type, fn);
-                }
-            }
+            const_cast<Pin*>(pIn->GetSource())->RemoveTarget(pIn);
+            pIn->SetSource(nullptr);
         }
     }
-    else
+    for (auto& pOut : pNode->GetOutputs())
     {
-        for (auto& out : node.GetOutputs())
+        for (auto& pTarget : pOut->GetTargets())
         {
-            if (type == ParameterType::None || type == out->GetType())
+            pTarget->SetSource(nullptr);
+        }
+        pOut->ClearTargets();
+    }
+
+    // Queued edits to its pins would land on freed memory, or on the pins of the next node to reuse it
+    m_changes.DiscardIf([pNode](const Parameter& param) {
+        auto isParam = [&param](const Pin* pPin) { return pPin == &param; };
+        auto& inputs = pNode->GetInputs();
+        auto& outputs = pNode->GetOutputs();
+        return std::any_of(inputs.begin(), inputs.end(), isParam) || std::any_of(outputs.begin(), outputs.end(), isParam);
+    });
+
+    auto removeFrom = [pNode](std::vector<Node*>& nodes) {
+        nodes.erase(std::remove(nodes.begin(), nodes.end(), pNode), nodes.end());
+    };
+    removeFrom(m_nodes);
+    removeFrom(m_typeIndex[pNode->GetType().hash()]);
+    removeFrom(m_displayNodes);
+    removeFrom(m_outputNodes);
+
+    auto index = pNode->GetIndex();
+    auto& slot = m_slots[index];
+    slot.spNode.reset();
+    slot.generation = slot.generation == NodeIdMaxGeneration ? 1 : slot.generation + 1;
+    m_freeSlots.push_back(index);
+    InvalidatePlan();
+}
+
+const ExecutionPlan& Graph::GetPlan(const std::vector<Node*>& roots)
+{
+    // Shared flow buffers need every node to write its outputs each compute, one level after another
+    bool reuseFlowBuffers = !m_incremental && m_computeMode != ComputeMode::WorkStealing;
+    if (m_plan.topologyVersion != m_topologyVersion || m_plan.roots != roots || m_plan.reuseFlowBuffers != reuseFlowBuffers)
+    {
+        BuildExecutionPlan(m_plan, roots, m_topologyVersion, m_mergeDuplicates, reuseFlowBuffers);
+        m_flowPool.Assign(m_plan);
+        m_batchScratch.resize(m_plan.nodes.size());
+        m_planGeneration = currentGeneration;
+        m_foldedValid = false;
+    }
+    else if (!m_plan.merges.empty() && SplitDuplicates(m_plan))
+    {
+        // Merged nodes stop being duplicates when one of their constants changes.  Only they are new to the plan;
+        // the folded nodes compute again in case one joined them
+        m_flowPool.Assign(m_plan);
+        m_batchScratch.resize(m_plan.nodes.size());
+        m_foldedValid = false;
+    }
+    return m_plan;
+}
+
+const std::vector<Node*>& Graph::GetLiveNodes()
+{
+    if (m_liveVersion == m_topologyVersion && m_liveOutputs == m_outputNodes)
+    {
+        return m_liveNodes;
+    }
+
+    m_liveVersion = m_topologyVersion;
+    m_liveOutputs = m_outputNodes;
+    m_liveNodes.clear();
+
+    // Post order walk up every connection, scalar ones too, so sources land ahead of the nodes that read them
+    struct StackEntry
+    {
+        Node* pNode;
+        size_t nextInput;
+    };
+    std::vector<StackEntry> stack;
+    std::vector<bool> visited(m_slots.size(), false);
+
+    for (auto& pOutput : m_outputNodes)
+    {
+        if (visited[pOutput->GetIndex()])
+        {
+            continue;
+        }
+
+        // A hidden node is only worth computing if something reads it
+        if (pOutput->IsHidden())
+        {
+            auto& pins = pOutput->GetOutputs();
+            if (std::none_of(pins.begin(), pins.end(), [](Pin* pPin) { return !pPin->GetTargets().empty(); }))
             {
-                for (auto& pTarget : out->GetTargets())
+                continue;
+            }
+        }
+
+        visited[pOutput->GetIndex()] = true;
+        stack.push_back(StackEntry{ pOutput, 0 });
+        while (!stack.empty())
+        {
+            auto& entry = stack.back();
+            auto& inputs = entry.pNode->GetInputs();
+
+            Node* pSourceNode = nullptr;
+            while (entry.nextInput < inputs.size() && pSourceNode == nullptr)
+            {
+                auto pSource = inputs[entry.nextInput++]->GetSource();
+                if (pSource && !visited[pSource->GetOwnerNode().GetIndex()])
                 {
-                    assert(&pTarget->GetOwnerNode() != &node);
-                    Visit(pTarget->GetOwnerNode(), dir, type, fn);
+                    pSourceNode = &pSource->GetOwnerNode();
                 }
             }
+
+            if (pSourceNode)
+            {
+                visited[pSourceNode->GetIndex()] = true;
+                stack.push_back(StackEntry{ pSourceNode, 0 });
+                continue;
+            }
+
+            m_liveNodes.push_back(entry.pNode);
+            stack.pop_back();
         }
     }
+    return m_liveNodes;
 }
 
-void Graph::Compute(const std::vector<Node*>& outNodes, int64_t numTicks)
+size_t Graph::GetEliminatedCount()
 {
-    MUtilsZoneScoped;
+    return m_nodes.size() - GetLiveNodes().size();
+}
 
-    currentGeneration++;
-    
-    using fnEval = std::function<void(Node * pEvalNode)>;
-    fnEval eval = [&](Node* pEvalNode) {
+void Graph::ComputeOutputs(int64_t numTicks, uint32_t frameCount)
+{
+    ComputeBlock(GetLiveNodes(), numTicks, frameCount);
+}
+
+// False if nothing the node reads has changed since it last computed
+bool Graph::NeedsCompute(Node& node) const
+{
+    return !m_incremental || node.GetComputeGeneration() < m_planGeneration || node.IsDirty();
+}
+
+void Graph::ComputeNode(Node& node, int64_t numTicks, uint32_t frameCount)
+{
+    // Left for ComputeStepped
+    if (m_stepping && node.GetIndex() < m_plan.stepped.size() && m_plan.stepped[node.GetIndex()])
+    {
+        return;
+    }
+
+    // Compute the node, unless nothing it reads has changed; the bank has already moved the ramps of its pins
+    if (NeedsCompute(node))
+    {
+        if (frameCount == 1 && !node.IsBlockAware())
+        {
+            node.Compute();
+        }
+        else
+        {
+            node.ComputeBlock(numTicks, frameCount);
+        }
+        node.MarkComputed(currentGeneration);
+    }
+
+    // It is now at the current generation
+    node.SetGeneration(currentGeneration);
+    FinishFlow(node);
+}
+
+void Graph::FinishFlow(Node& node)
+{
+    // Readers may only write over these outputs once the others are done; not when a node can skip a compute
+    // and leave them as they are, nor when stepped readers read them again at every frame
+    for (auto& pOutput : node.GetFlowOutputs())
+    {
+        pOutput->ResetReaders(!m_incremental && !m_stepping);
+    }
 
-        // Don't re-evaluate
-        if (pEvalNode->GetGeneration() == currentGeneration)
-            return;
+    for (auto& pInput : node.GetFlowInputs())
+    {
+        if (pInput->GetSource())
+        {
+            pInput->GetProducer()->ReleaseReader();
+        }
+    }
+}
+
+void Graph::ComputeBatch(const ExecutionPlan& plan, size_t batch, int64_t numTicks, uint32_t frameCount)
+{
+    auto start = plan.batchStarts[batch];
+    auto end = plan.batchStarts[batch + 1];
+    auto fnBatch = plan.nodes[start]->GetComputeBatch();
+
+    // Blocks go a node at a time, through ComputeBlock
+    if (fnBatch == nullptr || frameCount != 1 || end - start == 1)
+    {
+        for (auto index = start; index < end; index++)
+        {
+            ComputeNode(*plan.nodes[index], numTicks, frameCount);
+        }
+        return;
+    }
+
+    if (!m_incremental)
+    {
+        fnBatch(&plan.nodes[start], end - start);
+        for (auto index = start; index < end; index++)
+        {
+            plan.nodes[index]->MarkComputed(currentGeneration);
+            plan.nodes[index]->SetGeneration(currentGeneration);
+            FinishFlow(*plan.nodes[index]);
+        }
+        return;
+    }
+
+    // Only the nodes that changed; gathered into the batch's own slice of the scratch space, so threads
+    // working on other batches never touch it
+    assert(plan.nodes.size() <= m_batchScratch.size());
+    auto pReady = m_batchScratch.data() + start;
+    size_t readyCount = 0;
+    for (auto index = start; index < end; index++)
+    {
+        if (NeedsCompute(*plan.nodes[index]))
+        {
+            pReady[readyCount++] = plan.nodes[index];
+        }
+    }
+
+    if (readyCount != 0)
+    {
+        fnBatch(pReady, readyCount);
+        for (size_t index = 0; index < readyCount; index++)
+        {
+            pReady[index]->MarkComputed(currentGeneration);
+        }
+    }
+
+    for (auto index = start; index < end; index++)
+    {
+        plan.nodes[index]->SetGeneration(currentGeneration);
+        FinishFlow(*plan.nodes[index]);
+    }
+}
+
+void Graph::ComputeFolded(const ExecutionPlan& plan, int64_t numTicks, uint32_t frameCount)
+{
+    auto stamp = InputStamp(plan.foldedInputs);
+    if (m_foldedValid && stamp == m_foldedStamp)
+    {
+        return;
+    }
 
-        std::set<Node*> sourceEvalNodes;
+    for (auto& pNode : plan.folded)
+    {
+        ComputeNode(*pNode, numTicks, frameCount);
+    }
+
+    // Folded outputs last until the constants change, so their readers always copy to write
+    for (auto& pNode : plan.folded)
+    {
+        for (auto& pOutput : pNode->GetFlowOutputs())
+        {
+            pOutput->ResetReaders(false);
+        }
+    }
+    m_foldedStamp = stamp;
+    m_foldedValid = true;
+}
+
+void Graph::ComputeLevels(const ExecutionPlan& plan, int64_t numTicks, uint32_t frameCount)
+{
+    for (size_t level = 0; level < plan.LevelCount(); level++)
+    {
+        // Threads take whole batches
+        auto levelStart = plan.levelBatches[level];
+        auto levelSize = plan.levelBatches[level + 1] - levelStart;
 
-        for (auto& pin : pEvalNode->GetInputs())
+        auto chunkCount = std::min(levelSize, size_t(m_computeThreads));
+        if (chunkCount < 2)
         {
-            if (pin->GetDirection() == PinDir::Input && (pin->GetType() == ParameterType::FlowData || pin->GetType() == ParameterType::ControlData))
+            for (size_t batch = levelStart; batch < levelStart + levelSize; batch++)
             {
-                auto pSource = pin->GetSource();
-                if (pSource != nullptr && pSource->GetOwnerNode().GetGeneration() != currentGeneration)
+                ComputeBatch(plan, batch, numTicks, frameCount);
+            }
+            continue;
+        }
+
+        std::atomic<size_t> remaining = chunkCount;
+        std::exception_ptr spException;
+        std::mutex exceptionLock;
+
+        auto computeChunk = [&](size_t chunk) {
+            try
+            {
+                // Interleaved, so that neighbouring (often similar cost) nodes land on different threads
+                for (size_t batch = levelStart + chunk; batch < levelStart + levelSize; batch += chunkCount)
                 {
-                    auto pSourceNode = &pSource->GetOwnerNode();
-                    sourceEvalNodes.insert(pSourceNode);
+                    ComputeBatch(plan, batch, numTicks, frameCount);
                 }
             }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> guard(exceptionLock);
+                spException = std::current_exception();
+            }
+            remaining--;
+        };
+
+        for (size_t chunk = 1; chunk < chunkCount; chunk++)
+        {
+            m_threadPool.enqueue([&computeChunk, chunk]() { computeChunk(chunk); });
         }
+        computeChunk(0);
 
-        // Walk up to the parents, evaluating them
-        for (auto& pSource : sourceEvalNodes)
+        // Barrier; the next level reads the outputs of this one
+        while (remaining.load() != 0)
         {
-            eval(pSource);
+            std::this_thread::yield();
         }
 
-        // Portmento updates
-        for (auto& pin : pEvalNode->GetInputs())
+        if (spException)
         {
-            pin->Update(numTicks);
+            std::rethrow_exception(spException);
         }
+    }
+}
 
-        //LOG(DEBUG) << "Computing: " << pEvalNode->GetType().name();
+void Graph::ComputeStepped(const ExecutionPlan& plan, int64_t numTicks, uint32_t frameCount)
+{
+    // The whole stepped part of the plan for each frame, so every reader sees each frame of its sources
+    m_stepping = false;
+    for (uint32_t frame = 0; frame < frameCount; frame++)
+    {
+        auto tick = numTicks + int64_t(frame);
+        currentGeneration++;
+        m_parameterBank.Update(tick);
+        for (auto& pNode : plan.steppedNodes)
+        {
+            ComputeNode(*pNode, tick, 1);
+        }
+    }
+}
 
-        // Compute the node
-        pEvalNode->Compute();
+void Graph::Compute(const std::vector<Node*>& outNodes, int64_t numTicks)
+{
+    ComputeBlock(outNodes, numTicks, 1);
+}
+
+void Graph::ComputeBlock(const std::vector<Node*>& outNodes, int64_t numTicks, uint32_t frameCount)
+{
+    MUtilsZoneScoped;
 
-        // Output portmento
-        for (auto& pin : pEvalNode->GetOutputs())
+    assert(frameCount > 0);
+    currentGeneration++;
+
+    // Edits queued since the last compute; before the ramps move, so new ones start this block
+    m_changes.Drain();
+
+    // One pass over the ramps in flight, instead of an update per pin
+    m_parameterBank.Update(numTicks);
+
+    auto& plan = GetPlan(outNodes);
+
+    // Nodes downstream of one that isn't block aware need every frame of it; they wait for the rest of the block
+    m_stepping = frameCount != 1 && !plan.steppedNodes.empty();
+
+    if (!plan.folded.empty())
+    {
+        ComputeFolded(plan, numTicks, frameCount);
+    }
+
+    if (m_computeMode == ComputeMode::ParallelLevels)
+    {
+        ComputeLevels(plan, numTicks, frameCount);
+    }
+    else if (m_computeMode == ComputeMode::WorkStealing)
+    {
+        m_scheduler.Run(plan, m_threadPool, m_computeThreads, [&](Node& node) { ComputeNode(node, numTicks, frameCount); });
+    }
+    else
+    {
+        // Sources are always ahead of the nodes that read them
+        for (size_t batch = 0; batch < plan.BatchCount(); batch++)
         {
-            pin->Update(numTicks);
+            ComputeBatch(plan, batch, numTicks, frameCount);
         }
+    }
 
-        // It is now at the current generation
-        pEvalNode->SetGeneration(currentGeneration);
-    };
-    
-    for (auto& pNode : outNodes)
+    if (m_stepping)
     {
-        eval(pNode);
-    };
+        ComputeStepped(plan, numTicks, frameCount);
+    }
+
+    // Leave the ramps at the last frame of the block
+    if (frameCount != 1)
+    {
+        m_parameterBank.Update(numTicks + int64_t(frameCount) - 1);
+    }
 }
 
 std::vector<Pin*> Graph::GetControlSurface() const
 {
     // All pins that have interesting data to display
     std::vector<Pin*> pins;
-    for (auto& pNode : nodes)
+    for (auto& pNode : m_nodes)
     {
         for (auto& in : pNode->GetInputs())
         {
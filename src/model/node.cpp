@@ -1,30 +1,41 @@
+#include <algorithm>
 #include <cassert>
 
 #include "mutils/logger/logger.h"
 
+#include "nodegraph/model/graph.h"
 #include "nodegraph/model/node.h"
 #include "nodegraph/model/pin.h"
+#include "nodegraph/model/plan.h"
 
 using namespace MUtils;
 
 namespace NodeGraph
 {
 
-uint64_t Node::CurrentId = 0;
+Node::Node(Graph& graph, const std::string& name)
+    : m_strName(name),
+    m_graph(graph),
+    m_arena(graph.GetArena())
+{
+}
 
 Node::~Node()
 {
+    // The memory goes back to the graph's arena, for the next pins to reuse
+    ArenaDelete deletePin(m_arena, sizeof(Pin), alignof(Pin));
     for (auto& input : m_inputs)
     {
-        delete input;
+        deletePin(input);
     }
     for (auto& output : m_outputs)
     {
-        delete output;
+        deletePin(output);
     }
+    ArenaDelete deleteDecorator(m_arena, sizeof(NodeDecorator), alignof(NodeDecorator));
     for (auto& decorator : m_decorators)
     {
-        delete decorator;
+        deleteDecorator(decorator);
     }
 }
 
@@ -56,13 +67,19 @@ void Node::ConnectTo(Node* pDest, uint32_t outputIndex, int32_t inputIndex)
         {
             throw std::invalid_argument("Types don't match on pins");
         }
+
+        if (!pDest->GetInputs()[inputIndex]->AcceptsFlowFrom(*m_outputs[outputIndex]))
+        {
+            throw std::invalid_argument("Flow types don't match on pins");
+        }
     }
     else
     {
         if (m_outputs[outputIndex]->GetType() == ParameterType::FlowData)
         {
             int size = (int)pDest->GetFlowInputs().size();
-            pDest->AddInput(std::string("FlowIn_") + std::to_string(size), (IFlowData*)nullptr);
+            auto pIn = pDest->AddInput(std::string("FlowIn_") + std::to_string(size), (IFlowData*)nullptr);
+            pIn->SetFlowType(m_outputs[outputIndex]->GetFlowType());
             inputIndex = size;
         }
         else if (m_outputs[outputIndex]->GetType() == ParameterType::ControlData)
@@ -80,6 +97,7 @@ void Node::ConnectTo(Node* pDest, uint32_t outputIndex, int32_t inputIndex)
     // Connect it up
     m_outputs[outputIndex]->AddTarget(pDest->GetInputs()[inputIndex]);
     pDest->GetInputs()[inputIndex]->SetSource(m_outputs[outputIndex]);
+    m_graph.InvalidatePlan();
 }
 
 void Node::ConnectTo(Node* pDest, const std::string& outputName, const std::string& inName)
@@ -128,6 +146,7 @@ void Node::ConnectTo(Node* pDest, const std::string& outputName, const std::stri
         {
             int size = (int)pDest->GetFlowInputs().size();
             pIn = pDest->AddInput(std::string("FlowIn_") + std::to_string(size), (IFlowData*)nullptr);
+            pIn->SetFlowType(pOut->GetFlowType());
         }
         else if (pOut->GetType() == ParameterType::ControlData)
         {
@@ -155,9 +174,30 @@ void Node::ConnectTo(Node* pDest, const std::string& outputName, const std::stri
         throw std::invalid_argument("Can't connect more than one signal to the same input");
     }
 
+    if (pIn->GetType() != pOut->GetType())
+    {
+        throw std::invalid_argument("Types don't match on pins");
+    }
+
+    if (pIn->GetType() == ParameterType::FlowData && !pIn->AcceptsFlowFrom(*pOut))
+    {
+        throw std::invalid_argument("Flow types don't match on pins");
+    }
+
     // Connect it up
     pOut->AddTarget(pIn);
     pIn->SetSource(pOut);
+    m_graph.InvalidatePlan();
+}
+
+void Node::SetHidden(bool hidden)
+{
+    // A hidden output node is only live while something reads it
+    if (m_hidden != hidden)
+    {
+        m_hidden = hidden;
+        m_graph.InvalidatePlan();
+    }
 }
 
 void Node::Compute()
@@ -165,9 +205,93 @@ void Node::Compute()
     /* Default compute; do nothing */
 }
 
-// TODO: Optimize with a map later
+void Node::ComputeBlock(int64_t tick, uint32_t frameCount)
+{
+    for (int64_t frame = tick; frame < tick + int64_t(frameCount); frame++)
+    {
+        for (auto& pin : m_inputs)
+        {
+            pin->Update(frame);
+        }
+
+        Compute();
+
+        for (auto& pin : m_outputs)
+        {
+            pin->Update(frame);
+        }
+    }
+}
+
+bool Node::IsDirty() const
+{
+    if (m_computeGeneration == 0 || (m_flags & NodeFlags::Volatile))
+    {
+        return true;
+    }
+
+    // Flow/control data is written in place, so a recompute upstream is the only sign it changed
+    for (auto& pIn : m_inputs)
+    {
+        if (IsDependencyPin(*pIn) && pIn->GetProducer()->GetOwnerNode().GetComputeGeneration() > m_computeGeneration)
+        {
+            return true;
+        }
+    }
+
+    return InputStamp(m_inputs) != m_inputStamp;
+}
+
+void Node::MarkComputed(uint64_t gen)
+{
+    m_computeGeneration = gen;
+    m_inputStamp = InputStamp(m_inputs);
+}
+
+Pin* Node::AddPin(const PinSpec& spec, const Parameter& prototype)
+{
+    auto pPin = m_arena.New<Pin>(*this, spec.direction, spec.name, prototype);
+    if (spec.direction == PinDir::Input)
+    {
+        m_inputs.push_back(pPin);
+        if (spec.type == ParameterType::FlowData)
+        {
+            m_flowInputs.push_back(pPin);
+        }
+        else if (spec.type == ParameterType::ControlData)
+        {
+            m_controlInputs.push_back(pPin);
+        }
+    }
+    else
+    {
+        m_outputs.push_back(pPin);
+        if (spec.type == ParameterType::FlowData)
+        {
+            m_flowOutputs.push_back(pPin);
+        }
+        else if (spec.type == ParameterType::ControlData)
+        {
+            m_controlOutputs.push_back(pPin);
+        }
+    }
+    return pPin;
+}
+
 Pin* Node::GetPin(const std::string& name) const
 {
+    // Schema pins were sorted by name when the node type was compiled
+    auto pNamesEnd = m_pPinNames + m_pinNameCount;
+    auto pFound = std::lower_bound(m_pPinNames, pNamesEnd, name, [](const PinName& entry, const std::string& key) {
+        return key.compare(entry.name) > 0;
+    });
+    if (pFound != pNamesEnd && name == pFound->name)
+    {
+        return pFound->direction == PinDir::Input ? m_inputs[pFound->slot] : m_outputs[pFound->slot];
+    }
+
+    // Pins made by hand, or when connecting.  Only looked up by name while editing connections, and a node
+    // has few of them; a scan beats keeping a map up to date in every node
     for (auto& p : m_inputs)
     {
         if (p->GetName() == name)
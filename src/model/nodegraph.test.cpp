@@ -68,6 +68,43 @@ TEST_CASE("NodeGraph.Parameters", "[Parameters]")
         REQUIRE(old != p.GetGeneration());
     
     }
+
+    SECTION("Copies keep the metadata")
+    {
+        p.SetAttributes(ParameterAttributes(ParameterUI::Knob, 0.0f, 2.0f));
+        Parameter copy(p);
+        REQUIRE(copy.GetAttributes().ui == ParameterUI::Knob);
+        REQUIRE(copy.GetAttributes().max.To<float>() == 2.0f);
+        REQUIRE(copy.IsRamping());
+    }
+
+    SECTION("Identical attributes are shared until edited")
+    {
+        auto attrib = ParameterAttributes(ParameterUI::Slider, 0.0f, 10.0f);
+        attrib.postFix = "Hz";
+        Parameter a(1.0f, attrib);
+        Parameter b(2.0f, attrib);
+        const auto& constA = a;
+        const auto& constB = b;
+        REQUIRE(&constA.GetAttributes() == &constB.GetAttributes());
+
+        a.GetAttributes().postFix = "dB";
+        REQUIRE(&constA.GetAttributes() != &constB.GetAttributes());
+        REQUIRE(constA.GetAttributes().postFix == "dB");
+        REQUIRE(constB.GetAttributes().postFix == "Hz");
+
+        b.SetAttributes(constA.GetAttributes());
+        Parameter c(3.0f, constA.GetAttributes());
+        REQUIRE(&constB.GetAttributes() == &std::as_const(c).GetAttributes());
+    }
+
+    SECTION("String parameter")
+    {
+        Parameter str(std::string("Hello"));
+        REQUIRE(str.GetType() == ParameterType::String);
+        REQUIRE(str.GetParameterValue().sVal == "Hello");
+        REQUIRE_THROWS(str.Set(1.0f));
+    }
 }
 TEST_CASE("NodeGraph.Nodes", "[Nodes]")
 {
@@ -90,3 +127,1389 @@ TEST_CASE("NodeGraph.Nodes", "[Nodes]")
     val = pNode->pSum->GetValue<float>();
     REQUIRE(val == .6f);
 }
+
+class FlowTestNode : public Node
+{
+public:
+    DECLARE_NODE(FlowTestNode, flow);
+
+    FlowTestNode(Graph& m_graph, std::vector<Node*>* pOrder = nullptr)
+        : Node(m_graph, "Flow"),
+        m_pOrder(pOrder)
+    {
+        pOut = AddOutput("Out", (IFlowData*)nullptr);
+    }
+
+    virtual void Compute() override
+    {
+        if (m_pOrder)
+        {
+            m_pOrder->push_back(this);
+        }
+    }
+
+    Pin* pOut = nullptr;
+    std::vector<Node*>* m_pOrder;
+};
+
+TEST_CASE("NodeGraph.Plan", "[Plan]")
+{
+    Graph g;
+    std::vector<Node*> order;
+    auto pA = g.CreateNode<FlowTestNode>(&order);
+    auto pB = g.CreateNode<FlowTestNode>(&order);
+    auto pC = g.CreateNode<FlowTestNode>(&order);
+
+    pA->ConnectTo(pB, "Out", str_AutoGen);
+    pB->ConnectTo(pC, "Out", str_AutoGen);
+
+    g.Compute(std::vector<Node*>{ pC }, 0);
+    REQUIRE(order == std::vector<Node*>{ pA, pB, pC });
+
+    SECTION("Plan is reused while the topology is unchanged")
+    {
+        auto version = g.GetPlan({ pC }).topologyVersion;
+        g.Compute(std::vector<Node*>{ pC }, 1);
+        REQUIRE(g.GetPlan({ pC }).topologyVersion == version);
+    }
+
+    SECTION("Connecting a node rebuilds the plan")
+    {
+        auto pD = g.CreateNode<FlowTestNode>(&order);
+        pD->ConnectTo(pC, "Out", str_AutoGen);
+
+        order.clear();
+        g.Compute(std::vector<Node*>{ pC }, 1);
+        REQUIRE(order.size() == 4);
+        REQUIRE(order.back() == pC);
+        REQUIRE(std::find(order.begin(), order.end(), pD) != order.end());
+    }
+}
+
+// Computes its depth from the depth of its sources, so an out-of-order evaluation is visible
+class DepthTestNode : public Node
+{
+public:
+    DECLARE_NODE(DepthTestNode, depth);
+
+    DepthTestNode(Graph& m_graph)
+        : Node(m_graph, "Depth")
+    {
+        pOut = AddOutput("Out", (IFlowData*)nullptr);
+        pGain = AddInput("Gain", 1.0f);
+    }
+
+    virtual void Compute() override
+    {
+        int64_t maxDepth = -1;
+        for (auto& pIn : GetFlowInputs())
+        {
+            auto& source = static_cast<DepthTestNode&>(pIn->GetSource()->GetOwnerNode());
+            maxDepth = std::max(maxDepth, source.depth);
+        }
+        depth = maxDepth + 1;
+        computeCount++;
+    }
+
+    Pin* pOut = nullptr;
+    Pin* pGain = nullptr;
+    int64_t depth = -1;
+    int computeCount = 0;
+};
+
+TEST_CASE("NodeGraph.Parallel", "[Plan]")
+{
+    Graph g;
+    g.SetComputeMode(GENERATE(ComputeMode::ParallelLevels, ComputeMode::WorkStealing));
+    g.SetComputeThreads(4);
+
+    // A wide fan out of branches with different lengths, joined at the end
+    auto pSource = g.CreateNode<DepthTestNode>();
+    auto pSink = g.CreateNode<DepthTestNode>();
+    std::vector<DepthTestNode*> all{ pSource, pSink };
+    for (int branch = 0; branch < 16; branch++)
+    {
+        Node* pPrevious = pSource;
+        for (int length = 0; length <= branch % 4; length++)
+        {
+            auto pNode = g.CreateNode<DepthTestNode>();
+            pPrevious->ConnectTo(pNode, "Out", str_AutoGen);
+            pPrevious = pNode;
+            all.push_back(pNode);
+        }
+        pPrevious->ConnectTo(pSink, "Out", str_AutoGen);
+    }
+
+    g.Compute(std::vector<Node*>{ pSink }, 0);
+    REQUIRE(g.GetPlan({ pSink }).LevelCount() == 6);
+    REQUIRE(pSink->depth == 5);
+    for (auto& pNode : all)
+    {
+        REQUIRE(pNode->computeCount == 1);
+    }
+}
+
+TEST_CASE("NodeGraph.Incremental", "[Plan]")
+{
+    Graph g;
+    g.SetIncremental(true);
+
+    auto pA = g.CreateNode<DepthTestNode>();
+    auto pB = g.CreateNode<DepthTestNode>();
+    auto pC = g.CreateNode<DepthTestNode>();
+    pA->ConnectTo(pB, "Out", str_AutoGen);
+    pB->ConnectTo(pC, "Out", str_AutoGen);
+
+    std::vector<Node*> roots{ pC };
+    g.Compute(roots, 0);
+    REQUIRE(pA->computeCount == 1);
+    REQUIRE(pC->computeCount == 1);
+
+    SECTION("Nothing changed, nothing computed")
+    {
+        g.Compute(roots, 1);
+        REQUIRE(pA->computeCount == 1);
+        REQUIRE(pB->computeCount == 1);
+        REQUIRE(pC->computeCount == 1);
+    }
+
+    SECTION("An input change recomputes the node and everything downstream")
+    {
+        pB->pGain->Set(.5f, true);
+        g.Compute(roots, 1);
+        REQUIRE(pA->computeCount == 1);
+        REQUIRE(pB->computeCount == 2);
+        REQUIRE(pC->computeCount == 2);
+    }
+
+    SECTION("Volatile nodes always compute")
+    {
+        pA->SetFlags(NodeFlags::Volatile);
+        g.Compute(roots, 1);
+        REQUIRE(pA->computeCount == 2);
+        REQUIRE(pC->computeCount == 2);
+    }
+}
+
+// Sums its input over the block, one frame at a time
+class BlockTestNode : public Node
+{
+public:
+    DECLARE_NODE(BlockTestNode, block);
+
+    BlockTestNode(Graph& m_graph)
+        : Node(m_graph, "Block")
+    {
+        pIn = AddInput("In", 0.0f);
+    }
+
+    virtual bool IsBlockAware() const override
+    {
+        return true;
+    }
+
+    virtual void ComputeBlock(int64_t tick, uint32_t frameCount) override
+    {
+        blockCount++;
+        values.resize(frameCount);
+        pIn->RenderRamp(tick, values.data(), frameCount);
+        for (auto& value : values)
+        {
+            sum += value;
+        }
+    }
+
+    Pin* pIn = nullptr;
+    int blockCount = 0;
+    float sum = 0.0f;
+    std::vector<float> values;
+};
+
+// Passes its ramped gain down a flow, and keeps what it was given by its sources at each compute
+class FrameTestNode : public Node
+{
+public:
+    DECLARE_NODE(FrameTestNode, frame);
+
+    FrameTestNode(Graph& m_graph)
+        : Node(m_graph, "Frame")
+    {
+        pOut = AddOutput("Out", (IFlowData*)nullptr);
+        pGain = AddInput("Gain", 0.0f);
+    }
+
+    virtual void Compute() override
+    {
+        value = pGain->To<float>();
+        for (auto& pIn : GetFlowInputs())
+        {
+            seen.push_back(static_cast<FrameTestNode&>(pIn->GetSource()->GetOwnerNode()).value);
+        }
+    }
+
+    Pin* pOut = nullptr;
+    Pin* pGain = nullptr;
+    float value = 0.0f;
+    std::vector<float> seen;
+};
+
+TEST_CASE("NodeGraph.ComputeBlock", "[Plan]")
+{
+    Graph g;
+
+    SECTION("Block aware nodes compute once per block, with per frame ramp values")
+    {
+        auto pNode = g.CreateNode<BlockTestNode>();
+        pNode->pIn->SetLerpSamples(4);
+        pNode->pIn->Set(1.0f);
+
+        g.ComputeBlock(std::vector<Node*>{ pNode }, 0, 8);
+        REQUIRE(pNode->blockCount == 1);
+        REQUIRE(pNode->sum == Approx(0.0f + .25f + .5f + .75f + 4.0f));
+        REQUIRE(pNode->pIn->To<float>() == 1.0f);
+    }
+
+    SECTION("Rendered ramps match the per frame values")
+    {
+        Parameter f(0.0f), d(0.0);
+        f.SetLerpSamples(37);
+        d.SetLerpSamples(37);
+        f.Set(3.0f);
+        d.Set(-3.0);
+
+        std::vector<float> floats(64);
+        std::vector<double> doubles(64);
+        for (int64_t tick : { int64_t(-5), int64_t(0), int64_t(3), int64_t(30), int64_t(40) })
+        {
+            f.RenderRamp(tick, floats.data(), 61);
+            d.RenderRamp(tick, doubles.data(), 61);
+            for (int64_t frame = 0; frame < 61; frame++)
+            {
+                REQUIRE(floats[frame] == Approx(f.ValueAt<float>(tick + frame)));
+                REQUIRE(doubles[frame] == Approx(d.ValueAt<double>(tick + frame)));
+            }
+        }
+
+        // No ramp; a constant
+        Parameter idle(2.0f);
+        idle.RenderRamp(0, floats.data(), 64);
+        REQUIRE(std::all_of(floats.begin(), floats.end(), [](float value) { return value == 2.0f; }));
+    }
+
+    SECTION("Other nodes compute once per frame")
+    {
+        auto pNode = g.CreateNode<DepthTestNode>();
+        g.ComputeBlock(std::vector<Node*>{ pNode }, 0, 8);
+        REQUIRE(pNode->computeCount == 8);
+    }
+
+    SECTION("Readers of nodes that aren't block aware see every frame")
+    {
+        auto pA = g.CreateNode<FrameTestNode>();
+        auto pB = g.CreateNode<FrameTestNode>();
+        auto pAfter = g.CreateNode<BlockTestNode>();
+        auto pAlone = g.CreateNode<BlockTestNode>();
+        pA->ConnectTo(pB, "Out", str_AutoGen);
+        pB->ConnectTo(pAfter, "Out", str_AutoGen);
+        pA->pGain->SetLerpSamples(4);
+        pA->pGain->Set(1.0f);
+        for (auto& pBlock : { pAfter, pAlone })
+        {
+            pBlock->pIn->SetLerpSamples(4);
+            pBlock->pIn->Set(1.0f);
+        }
+
+        // Only A and what reads it go a frame at a time; block aware nodes there get blocks of one
+        auto roots = std::vector<Node*>{ pAfter, pAlone };
+        g.ComputeBlock(roots, 0, 8);
+        REQUIRE(g.GetPlan(roots).steppedNodes == std::vector<Node*>{ pA, pB, pAfter });
+        REQUIRE(pB->seen == std::vector<float>{ 0.0f, .25f, .5f, .75f, 1.0f, 1.0f, 1.0f, 1.0f });
+        REQUIRE(pAfter->blockCount == 8);
+        REQUIRE(pAfter->sum == Approx(0.0f + .25f + .5f + .75f + 4.0f));
+        REQUIRE(pAlone->blockCount == 1);
+        REQUIRE(pAlone->sum == Approx(0.0f + .25f + .5f + .75f + 4.0f));
+        REQUIRE(pA->pGain->To<float>() == 1.0f);
+
+        // Single frames walk the plan as usual
+        g.Compute(roots, 8);
+        REQUIRE(pB->seen.size() == 9);
+        REQUIRE(pAlone->blockCount == 2);
+    }
+
+    SECTION("Plans of block aware readers keep whole blocks")
+    {
+        auto pA = g.CreateNode<FrameTestNode>();
+        auto pBlock = g.CreateNode<BlockTestNode>();
+        g.ComputeBlock(std::vector<Node*>{ pA, pBlock }, 0, 8);
+        REQUIRE(g.GetPlan(std::vector<Node*>{ pA, pBlock }).steppedNodes.empty());
+        REQUIRE(pBlock->blockCount == 1);
+    }
+}
+
+TEST_CASE("NodeGraph.Visit", "[Graph]")
+{
+    // Layers of diamonds; a naive walk visits the bottom node 2^40 times
+    Graph g;
+    auto pTop = g.CreateNode<DepthTestNode>();
+    Node* pBottom = pTop;
+    for (int layer = 0; layer < 40; layer++)
+    {
+        auto pLeft = g.CreateNode<DepthTestNode>();
+        auto pRight = g.CreateNode<DepthTestNode>();
+        auto pJoin = g.CreateNode<DepthTestNode>();
+        pBottom->ConnectTo(pLeft, "Out", str_AutoGen);
+        pBottom->ConnectTo(pRight, "Out", str_AutoGen);
+        pLeft->ConnectTo(pJoin, "Out", str_AutoGen);
+        pRight->ConnectTo(pJoin, "Out", str_AutoGen);
+        pBottom = pJoin;
+    }
+
+    int visits = 0;
+    g.Visit(*pBottom, PinDir::Input, ParameterType::FlowData, [&](Node&) { visits++; });
+    REQUIRE(visits == 121);
+
+    visits = 0;
+    g.Visit(*pTop, PinDir::Output, ParameterType::None, [&](Node&) { return ++visits < 10; });
+    REQUIRE(visits == 10);
+}
+
+TEST_CASE("NodeGraph.Find", "[Graph]")
+{
+    Graph g;
+    auto pAdder = g.CreateNode<TestNode>();
+    auto pDepth1 = g.CreateNode<DepthTestNode>();
+    auto pDepth2 = g.CreateNode<DepthTestNode>();
+
+    auto depthNodes = g.Find<DepthTestNode>(DepthTestNode::TypeID());
+    REQUIRE(depthNodes.size() == 2);
+    REQUIRE(depthNodes[0] == pDepth1);
+    REQUIRE(depthNodes[1] == pDepth2);
+
+    REQUIRE(g.Find<FlowTestNode>(FlowTestNode::TypeID()).empty());
+
+    auto all = g.Find<Node>({ TestNode::TypeID(), DepthTestNode::TypeID(), TestNode::TypeID() });
+    REQUIRE(all.size() == 3);
+    REQUIRE(std::vector<Node*>(all.begin(), all.end()) == std::vector<Node*>{ pAdder, pDepth1, pDepth2 });
+
+    // Missing types are skipped, wherever they fall in the list
+    auto some = g.Find<Node>({ FlowTestNode::TypeID(), DepthTestNode::TypeID(), FlowTestNode::TypeID() });
+    REQUIRE(std::vector<Node*>(some.begin(), some.end()) == std::vector<Node*>{ pDepth1, pDepth2 });
+    auto none = g.Find<Node>({ FlowTestNode::TypeID() });
+    REQUIRE(none.empty());
+    REQUIRE(none.begin() == none.end());
+}
+
+TEST_CASE("NodeGraph.NodeIds", "[Graph]")
+{
+    Graph g;
+    auto pA = g.CreateNode<DepthTestNode>();
+    auto pB = g.CreateNode<DepthTestNode>();
+    auto pC = g.CreateNode<DepthTestNode>();
+    pA->ConnectTo(pB, "Out", str_AutoGen);
+    pB->ConnectTo(pC, "Out", str_AutoGen);
+
+    REQUIRE(g.GetNode(pB->GetId()) == pB);
+    REQUIRE(g.GetNodes() == std::vector<Node*>{ pA, pB, pC });
+
+    auto idB = pB->GetId();
+    g.DestroyNode(pB);
+    REQUIRE(g.GetNode(idB) == nullptr);
+    REQUIRE(g.GetNodes() == std::vector<Node*>{ pA, pC });
+    REQUIRE(pA->pOut->GetTargets().empty());
+    REQUIRE(pC->GetFlowInputs()[0]->GetSource() == nullptr);
+
+    // The slot is reused, but the old id still doesn't resolve
+    auto pD = g.CreateNode<DepthTestNode>();
+    REQUIRE(pD->GetIndex() == (idB & NodeIdIndexMask));
+    REQUIRE(pD->GetId() != idB);
+    REQUIRE(g.GetNode(idB) == nullptr);
+    REQUIRE(g.GetNode(pD->GetId()) == pD);
+    REQUIRE(g.GetNodes().back() == pD);
+}
+
+TEST_CASE("NodeGraph.Arena", "[Graph]")
+{
+    Graph g;
+    auto pNode = g.CreateNode<DepthTestNode>();
+    auto pDecorator = pNode->AddDecorator(DecoratorType::Label, "Label");
+    REQUIRE(pDecorator->strName == "Label");
+
+    // In a fresh arena, a node's pins are allocated back to back
+    REQUIRE(pNode->GetOutputs()[0] + 1 == pNode->GetInputs()[0]);
+    REQUIRE(g.GetArena().GetBytesAllocated() >= sizeof(DepthTestNode) + 2 * sizeof(Pin));
+
+    SECTION("Deleted nodes and pins are reused")
+    {
+        auto bytes = g.GetArena().GetBytesAllocated();
+        auto pFirst = g.CreateNode<DepthTestNode>();
+        pNode->ConnectTo(pFirst, "Out", str_AutoGen);
+        g.DestroyNode(pFirst);
+        REQUIRE(g.GetArena().GetBytesAllocated() == bytes);
+
+        // An editor session creating, connecting and deleting nodes stays the same size
+        for (int i = 0; i < 100; i++)
+        {
+            auto pNext = g.CreateNode<DepthTestNode>();
+            REQUIRE(pNext == pFirst);
+            pNode->ConnectTo(pNext, "Out", str_AutoGen);
+            g.DestroyNode(pNext);
+            REQUIRE(g.GetArena().GetBytesAllocated() == bytes);
+        }
+    }
+
+    g.Destroy();
+    REQUIRE(g.GetArena().GetBytesAllocated() == 0);
+}
+
+TEST_CASE("NodeGraph.ParameterBank", "[Parameters]")
+{
+    Graph g;
+    std::vector<TestNode*> nodes;
+    std::vector<std::unique_ptr<Parameter>> expected;
+    for (int i = 0; i < 7; i++)
+    {
+        auto pNode = g.CreateNode<TestNode>();
+        pNode->pValue1->SetLerpSamples(10);
+        pNode->pValue1->Set(float(i + 1));
+        nodes.push_back(pNode);
+
+        expected.push_back(std::make_unique<Parameter>(0.0f));
+        expected.back()->SetLerpSamples(10);
+        expected.back()->Set(float(i + 1));
+    }
+    // Only the pins with a ramp in flight
+    REQUIRE(g.GetParameterBank().GetActiveCount() == 7);
+    REQUIRE(nodes[0]->pValue2->IsBanked());
+
+    // The bank moves the ramps the same way Update would
+    for (int64_t tick = 0; tick < 12; tick++)
+    {
+        g.Compute(std::vector<Node*>(nodes.begin(), nodes.end()), tick);
+        for (size_t i = 0; i < nodes.size(); i++)
+        {
+            expected[i]->Update(tick);
+            REQUIRE(nodes[i]->pValue1->To<float>() == Approx(expected[i]->To<float>()));
+            REQUIRE(nodes[i]->pSum->To<float>() == Approx(expected[i]->To<float>()));
+        }
+    }
+    REQUIRE_FALSE(nodes[6]->pValue1->IsRamping());
+    REQUIRE(g.GetParameterBank().GetActiveCount() == 0);
+
+    // An idle ramp is not written back
+    auto generation = nodes[0]->pValue1->GetGeneration();
+    g.Compute(std::vector<Node*>{ nodes[0] }, 20);
+    REQUIRE(nodes[0]->pValue1->GetGeneration() == generation);
+
+    nodes[3]->pValue1->Set(0.0f);
+    REQUIRE(g.GetParameterBank().GetActiveCount() == 1);
+    g.DestroyNode(nodes[3]);
+    REQUIRE(g.GetParameterBank().GetActiveCount() == 0);
+
+    SECTION("Int ramps")
+    {
+        auto pInt = nodes[0]->AddInput("Int", int64_t(0));
+        pInt->SetLerpSamples(4);
+        pInt->Set(int64_t(8));
+        REQUIRE(g.GetParameterBank().GetActiveCount() == 1);
+        g.Compute(std::vector<Node*>{ nodes[0] }, 22);
+        REQUIRE(pInt->To<int64_t>() == 4);
+        g.Compute(std::vector<Node*>{ nodes[0] }, 24);
+        REQUIRE(pInt->To<int64_t>() == 8);
+        REQUIRE(g.GetParameterBank().GetActiveCount() == 0);
+    }
+
+    SECTION("Doubles")
+    {
+        ParameterBank bank;
+        Parameter d(0.0), ref(0.0);
+        bank.Add(d);
+        d.SetLerpSamples(4);
+        ref.SetLerpSamples(4);
+        d.Set(2.0);
+        ref.Set(2.0);
+        for (int64_t tick = 0; tick < 6; tick++)
+        {
+            bank.Update(tick);
+            ref.Update(tick);
+            REQUIRE(d.To<double>() == Approx(ref.To<double>()));
+        }
+    }
+}
+
+TEST_CASE("NodeGraph.DirectReads", "[Nodes]")
+{
+    Graph g;
+    auto pSource = g.CreateNode<TestNode>();
+    auto pDest = g.CreateNode<TestNode>();
+    pSource->pValue1->Set(.25f, true);
+    pDest->pValue2->Set(.5f, true);
+
+    pSource->ConnectTo(pDest, "Sum", "Value1");
+    g.Compute(std::vector<Node*>{ pSource, pDest }, 0);
+
+    // Reads go straight to the source's value
+    REQUIRE(pDest->pValue1->Value<float>() == .25f);
+    REQUIRE(pDest->pValue1->GetValue<double>() == .25);
+    REQUIRE(pDest->pValue2->Value<float>() == .5f);
+
+    // Only pins of the same type connect
+    auto pInt = pDest->AddInput("Int", int64_t(0));
+    REQUIRE_THROWS(pSource->ConnectTo(pDest, "Sum", "Int"));
+    REQUIRE(pInt->GetSource() == nullptr);
+
+    // Disconnected pins read their own value again
+    g.DestroyNode(pSource);
+    REQUIRE(pDest->pValue1->Value<float>() == 0.0f);
+}
+
+class BatchAddNode : public BatchNode<BatchAddNode>
+{
+public:
+    DECLARE_NODE(BatchAddNode, batchadd);
+
+    BatchAddNode(Graph& m_graph)
+        : BatchNode(m_graph, "BatchAdd")
+    {
+        pSum = AddOutput("Sum", .0f);
+        pValue1 = AddInput("Value1", .0f);
+        pValue2 = AddInput("Value2", .0f);
+    }
+
+    static void ComputeBatch(const NodeBatch<BatchAddNode>& nodes)
+    {
+        batchSizes.push_back(nodes.size());
+        for (size_t index = 0; index < nodes.size(); index++)
+        {
+            auto& node = nodes[index];
+            node.pSum->Set(node.pValue1->Value<float>() + node.pValue2->Value<float>());
+        }
+    }
+
+    Pin* pSum = nullptr;
+    Pin* pValue1 = nullptr;
+    Pin* pValue2 = nullptr;
+    static std::vector<size_t> batchSizes;
+};
+std::vector<size_t> BatchAddNode::batchSizes;
+
+TEST_CASE("NodeGraph.Batch", "[Plan]")
+{
+    Graph g;
+    BatchAddNode::batchSizes.clear();
+
+    // Batch nodes interleaved with others; each level groups its batch nodes together
+    std::vector<Node*> roots;
+    std::vector<BatchAddNode*> adders;
+    for (int i = 0; i < 20; i++)
+    {
+        auto pAdder = g.CreateNode<BatchAddNode>();
+        pAdder->pValue1->Set(float(i), true);
+        pAdder->pValue2->Set(1.0f, true);
+        adders.push_back(pAdder);
+        roots.push_back(pAdder);
+        roots.push_back(g.CreateNode<TestNode>());
+    }
+
+    auto mode = GENERATE(ComputeMode::Sequential, ComputeMode::ParallelLevels);
+    g.SetComputeMode(mode);
+    g.SetComputeThreads(4);
+    g.Compute(roots, 0);
+
+    REQUIRE(g.GetPlan(roots).BatchCount() == 21);
+    REQUIRE(BatchAddNode::batchSizes == std::vector<size_t>{ 20 });
+    for (int i = 0; i < 20; i++)
+    {
+        REQUIRE(adders[i]->pSum->To<float>() == float(i + 1));
+    }
+
+    SECTION("Incremental batches only hold the changed nodes")
+    {
+        g.SetIncremental(true);
+        g.Compute(roots, 1);
+        BatchAddNode::batchSizes.clear();
+
+        adders[3]->pValue2->Set(2.0f, true);
+        adders[7]->pValue2->Set(2.0f, true);
+        g.Compute(roots, 2);
+        REQUIRE(BatchAddNode::batchSizes == std::vector<size_t>{ 2 });
+        REQUIRE(adders[3]->pSum->To<float>() == 5.0f);
+    }
+}
+
+class SchemaTestNode : public Node
+{
+public:
+    DECLARE_NODE_PINS(SchemaTestNode, schema,
+        OutputPin("Sum", ParameterType::Float),
+        InputPin("Value", ParameterType::Float, 1.0, ParameterUI::Knob, 0.0, 2.0),
+        InputPin("Flow", ParameterType::FlowData),
+        InputPin("Count", ParameterType::Int64, 3.0));
+
+    enum
+    {
+        Sum,
+        Value,
+        Flow,
+        Count
+    };
+
+    SchemaTestNode(Graph& m_graph)
+        : Node(m_graph, "Schema")
+    {
+        AddPins<SchemaTestNode>();
+    }
+
+    virtual void Compute() override
+    {
+        Write<Sum>(Read<Value>() + float(Read<Count>()));
+    }
+};
+
+TEST_CASE("NodeGraph.PinSchema", "[Nodes]")
+{
+    Graph g;
+    auto pNode = g.CreateNode<SchemaTestNode>();
+    auto pOther = g.CreateNode<SchemaTestNode>();
+
+    REQUIRE(pNode->GetInputs().size() == 3);
+    REQUIRE(pNode->GetOutputs().size() == 1);
+    REQUIRE(pNode->GetFlowInputs().size() == 1);
+    REQUIRE(pNode->PinAt<SchemaTestNode::Count>()->GetType() == ParameterType::Int64);
+
+    // Names are found through the schema's sorted table; other pins by a scan
+    static_assert(NodeGraph::ComparePinNames(SchemaTestNode::PinNames[0].name, "Count") == 0, "Schema names are sorted");
+    REQUIRE(pNode->PinAt<SchemaTestNode::Count>() == pNode->GetPin("Count"));
+    REQUIRE(pNode->PinAt<SchemaTestNode::Sum>() == pNode->GetPin("Sum"));
+    REQUIRE(pNode->PinAt<SchemaTestNode::Value>() == pNode->GetPin("Value"));
+    REQUIRE(pNode->GetPin("Values") == nullptr);
+    REQUIRE(pNode->GetPin("") == nullptr);
+    g.CreateNode<DepthTestNode>()->ConnectTo(pNode, "Out", str_AutoGen);
+    REQUIRE(pNode->GetPin(pNode->GetInputs().back()->GetName()) == pNode->GetInputs().back());
+
+    // Pins of every instance share their attributes
+    const auto& attributes = std::as_const(*pNode->PinAt<SchemaTestNode::Value>()).GetAttributes();
+    REQUIRE(attributes.ui == ParameterUI::Knob);
+    REQUIRE(attributes.max.To<float>() == 2.0f);
+    REQUIRE(&attributes == &std::as_const(*pOther->PinAt<SchemaTestNode::Value>()).GetAttributes());
+
+    g.Compute(std::vector<Node*>{ pNode }, 0);
+    REQUIRE(pNode->Read<SchemaTestNode::Sum>() == 4.0f);
+}
+
+class PureTestNode : public TestNode
+{
+public:
+    PureTestNode(Graph& m_graph)
+        : TestNode(m_graph)
+    {
+        SetFlags(NodeFlags::Pure);
+    }
+
+    virtual void Compute() override
+    {
+        computeCount++;
+        pSum->Set(pValue1->GetValue<float>() + pValue2->GetValue<float>());
+    }
+
+    int computeCount = 0;
+};
+
+TEST_CASE("NodeGraph.ConstantFolding", "[Plan]")
+{
+    Graph g;
+
+    // Constants -> A -> B, folded; C reads B and stays in the schedule
+    auto pA = g.CreateNode<PureTestNode>();
+    auto pB = g.CreateNode<PureTestNode>();
+    auto pC = g.CreateNode<TestNode>();
+    pA->ConnectTo(pB, "Sum", "Value1");
+    pB->ConnectTo(pC, "Sum", "Value1");
+    pA->pValue1->Set(1.0f, true);
+    pA->pValue2->Set(2.0f, true);
+    pB->pValue2->Set(3.0f, true);
+
+    auto roots = std::vector<Node*>{ pA, pB, pC };
+    auto& plan = g.GetPlan(roots);
+    REQUIRE(plan.folded == std::vector<Node*>{ pA, pB });
+    REQUIRE(plan.nodes == std::vector<Node*>{ pC });
+
+    for (int64_t tick = 0; tick < 4; tick++)
+    {
+        g.Compute(roots, tick);
+    }
+    REQUIRE(pA->computeCount == 1);
+    REQUIRE(pB->computeCount == 1);
+    REQUIRE(pB->pSum->To<float>() == 6.0f);
+
+    // A constant changes; the folded nodes compute once more
+    pA->pValue2->Set(4.0f, true);
+    g.Compute(roots, 4);
+    g.Compute(roots, 5);
+    REQUIRE(pA->computeCount == 2);
+    REQUIRE(pB->computeCount == 2);
+    REQUIRE(pB->pSum->To<float>() == 8.0f);
+
+    SECTION("Volatile nodes and their readers are never folded")
+    {
+        pA->SetFlags(NodeFlags::Pure | NodeFlags::Volatile);
+        g.InvalidatePlan();
+        REQUIRE(g.GetPlan(roots).folded.empty());
+    }
+}
+
+TEST_CASE("NodeGraph.DeadNodes", "[Plan]")
+{
+    Graph g;
+    std::vector<Node*> order;
+    auto pA = g.CreateNode<FlowTestNode>(&order);
+    auto pB = g.CreateNode<FlowTestNode>(&order);
+    auto pOut = g.CreateNode<TestNode>();
+    pA->ConnectTo(pB, "Out", str_AutoGen);
+    pB->ConnectTo(pOut, "Out", str_AutoGen);
+
+    // A scratch area, and a hidden node that nothing reads
+    auto pScratch1 = g.CreateNode<FlowTestNode>(&order);
+    auto pScratch2 = g.CreateNode<FlowTestNode>(&order);
+    pScratch1->ConnectTo(pScratch2, "Out", str_AutoGen);
+    auto pHidden = g.CreateNode<FlowTestNode>(&order);
+    pHidden->SetHidden(true);
+
+    g.SetOutputNoes({ pOut, pHidden });
+    g.ComputeOutputs(0);
+
+    REQUIRE(order == std::vector<Node*>{ pA, pB });
+    REQUIRE(g.GetLiveNodes() == std::vector<Node*>{ pA, pB, pOut });
+    REQUIRE(g.GetEliminatedCount() == 3);
+
+    SECTION("Connecting the scratch area brings it back")
+    {
+        pScratch2->ConnectTo(pOut, "Out", str_AutoGen);
+        REQUIRE(g.GetEliminatedCount() == 1);
+    }
+
+    SECTION("Showing or hiding an output changes what is live")
+    {
+        pHidden->SetHidden(false);
+        REQUIRE(g.GetEliminatedCount() == 2);
+
+        order.clear();
+        g.ComputeOutputs(1);
+        REQUIRE(std::find(order.begin(), order.end(), pHidden) != order.end());
+
+        pHidden->SetHidden(true);
+        REQUIRE(g.GetEliminatedCount() == 3);
+    }
+}
+
+TEST_CASE("NodeGraph.CommonSubexpressions", "[Plan]")
+{
+    Graph g;
+    g.SetMergeDuplicates(true);
+
+    // S feeds two identical pure chains, A -> D and B -> E; C adds up the ends
+    auto pS = g.CreateNode<TestNode>();
+    auto pA = g.CreateNode<PureTestNode>();
+    auto pB = g.CreateNode<PureTestNode>();
+    auto pD = g.CreateNode<PureTestNode>();
+    auto pE = g.CreateNode<PureTestNode>();
+    auto pC = g.CreateNode<TestNode>();
+    pS->ConnectTo(pA, "Sum", "Value1");
+    pS->ConnectTo(pB, "Sum", "Value1");
+    pA->ConnectTo(pD, "Sum", "Value1");
+    pB->ConnectTo(pE, "Sum", "Value1");
+    pD->ConnectTo(pC, "Sum", "Value1");
+    pE->ConnectTo(pC, "Sum", "Value2");
+    pS->pValue1->Set(1.0f, true);
+    pA->pValue2->Set(2.0f, true);
+    pB->pValue2->Set(2.0f, true);
+
+    auto roots = std::vector<Node*>{ pS, pA, pB, pD, pE, pC };
+    auto& plan = g.GetPlan(roots);
+    REQUIRE(plan.nodes == std::vector<Node*>{ pS, pA, pD, pC });
+    REQUIRE(plan.duplicates[pA->GetIndex()] == std::vector<Node*>{ pB });
+    REQUIRE(plan.duplicates[pD->GetIndex()] == std::vector<Node*>{ pE });
+
+    g.Compute(roots, 0);
+    REQUIRE(pA->computeCount == 1);
+    REQUIRE(pB->computeCount == 0);
+    REQUIRE(pE->computeCount == 0);
+    REQUIRE(pC->pValue2->GetValue<float>() == 3.0f);
+
+    // The graph itself is untouched; only where the readers read from changes
+    REQUIRE(pE->GetInputs()[0]->GetSource() == pB->pSum);
+    REQUIRE(pC->pValue2->GetSource() == pE->pSum);
+    REQUIRE(pC->pValue2->GetProducer() == pD->pSum);
+    REQUIRE(pD->pSum->GetReaderCount() == 2);
+
+    SECTION("A different constant splits them again")
+    {
+        pB->pValue2->Set(5.0f, true);
+        g.Compute(roots, 1);
+        REQUIRE(pB->computeCount == 1);
+        REQUIRE(pE->computeCount == 1);
+        REQUIRE(pE->pSum->To<float>() == 6.0f);
+        REQUIRE(pC->pValue2->GetValue<float>() == 6.0f);
+        REQUIRE(pC->pValue2->GetProducer() == pE->pSum);
+        REQUIRE(pD->pSum->GetReaderCount() == 1);
+        REQUIRE(g.GetPlan(roots).nodes.size() == 6);
+    }
+
+    SECTION("Destroying a survivor gives its readers back")
+    {
+        g.DestroyNode(pA);
+        REQUIRE(pE->GetInputs()[0]->GetProducer() == pB->pSum);
+        REQUIRE(pC->pValue2->GetProducer() == pE->pSum);
+
+        roots = std::vector<Node*>{ pS, pB, pD, pE, pC };
+        g.Compute(roots, 1);
+        REQUIRE(pB->computeCount == 1);
+        REQUIRE(pC->pValue2->GetValue<float>() == 3.0f);
+    }
+
+    SECTION("Splitting leaves the rest of the plan alone")
+    {
+        g.SetIncremental(true);
+        g.Compute(roots, 1);
+        auto version = g.GetPlan(roots).topologyVersion;
+        auto computed = pA->computeCount;
+
+        // Only the split nodes compute; the others are still clean
+        pB->pValue2->Set(5.0f, true);
+        g.Compute(roots, 2);
+        REQUIRE(g.GetPlan(roots).topologyVersion == version);
+        REQUIRE(pA->computeCount == computed);
+        REQUIRE(pB->computeCount == 1);
+        REQUIRE(pE->computeCount == 1);
+        REQUIRE(pE->pSum->To<float>() == 6.0f);
+    }
+
+    SECTION("A split duplicate of a folded node is folded")
+    {
+        // F is folded because the node it reads is a duplicate of a folded one
+        auto pP = g.CreateNode<PureTestNode>();
+        auto pQ = g.CreateNode<PureTestNode>();
+        auto pF = g.CreateNode<PureTestNode>();
+        pQ->ConnectTo(pF, "Sum", "Value1");
+        pP->pValue1->Set(4.0f, true);
+        pQ->pValue1->Set(4.0f, true);
+
+        auto folded = std::vector<Node*>{ pP, pQ, pF };
+        g.Compute(folded, 1);
+        REQUIRE(g.GetPlan(folded).folded == std::vector<Node*>{ pP, pF });
+        REQUIRE(pF->pSum->To<float>() == 4.0f);
+
+        pQ->pValue1->Set(6.0f, true);
+        g.Compute(folded, 2);
+        REQUIRE(g.GetPlan(folded).folded == std::vector<Node*>{ pP, pQ, pF });
+        REQUIRE(pF->pSum->To<float>() == 6.0f);
+    }
+
+    SECTION("Off by default")
+    {
+        g.SetMergeDuplicates(false);
+        REQUIRE(g.GetPlan(roots).nodes.size() == 6);
+    }
+}
+
+// A flow buffer holding one value; each node adds one to what it reads
+struct CountFlowData : public IFlowData
+{
+    int value = 0;
+
+    virtual std::unique_ptr<IFlowData> Clone() const override
+    {
+        return std::make_unique<CountFlowData>(*this);
+    }
+
+    virtual void CopyFrom(const IFlowData& other) override
+    {
+        value = static_cast<const CountFlowData&>(other).value;
+    }
+};
+
+class PooledTestNode : public Node
+{
+public:
+    DECLARE_NODE(PooledTestNode, pooled);
+
+    PooledTestNode(Graph& m_graph)
+        : Node(m_graph, "Pooled")
+    {
+        pOut = AddOutput("Out", &PooledTestNode::CreateBuffer);
+    }
+
+    static std::unique_ptr<IFlowData> CreateBuffer()
+    {
+        return std::make_unique<CountFlowData>();
+    }
+
+    virtual void Compute() override
+    {
+        int value = 0;
+        for (auto& pIn : GetFlowInputs())
+        {
+            value = std::max(value, static_cast<CountFlowData*>(pIn->GetFlowData())->value);
+        }
+        static_cast<CountFlowData*>(pOut->GetFlowData())->value = value + 1;
+    }
+
+    Pin* pOut = nullptr;
+};
+
+// A pure node that makes a flow buffer holding the sum of its inputs
+class PureFlowTestNode : public Node
+{
+public:
+    DECLARE_NODE(PureFlowTestNode, pureflow);
+
+    PureFlowTestNode(Graph& m_graph)
+        : Node(m_graph, "PureFlow")
+    {
+        SetFlags(NodeFlags::Pure);
+        pValue = AddInput("Value", .0f);
+        pOffset = AddInput("Offset", .0f);
+        pOut = AddOutput("Out", &PooledTestNode::CreateBuffer);
+    }
+
+    virtual void Compute() override
+    {
+        computeCount++;
+        static_cast<CountFlowData*>(pOut->GetFlowData())->value = int(pValue->GetValue<float>() + pOffset->GetValue<float>());
+    }
+
+    Pin* pValue = nullptr;
+    Pin* pOffset = nullptr;
+    Pin* pOut = nullptr;
+    int computeCount = 0;
+};
+
+TEST_CASE("NodeGraph.MergeFlowOutputs", "[Plan]")
+{
+    Graph g;
+    g.SetMergeDuplicates(true);
+
+    // Two identical pure nodes making flow buffers, each with a reader
+    auto pSource = g.CreateNode<TestNode>();
+    auto pA = g.CreateNode<PureFlowTestNode>();
+    auto pB = g.CreateNode<PureFlowTestNode>();
+    auto pReadA = g.CreateNode<PooledTestNode>();
+    auto pReadB = g.CreateNode<PooledTestNode>();
+    pSource->ConnectTo(pA, "Sum", "Value");
+    pSource->ConnectTo(pB, "Sum", "Value");
+    pA->ConnectTo(pReadA, "Out", str_AutoGen);
+    pB->ConnectTo(pReadB, "Out", str_AutoGen);
+    pSource->pValue1->Set(2.0f, true);
+
+    auto roots = std::vector<Node*>{ pSource, pReadA, pReadB };
+    REQUIRE(g.GetPlan(roots).duplicates[pA->GetIndex()] == std::vector<Node*>{ pB });
+
+    // Both readers read the survivor's buffer
+    g.Compute(roots, 0);
+    REQUIRE(pA->computeCount == 1);
+    REQUIRE(pB->computeCount == 0);
+    REQUIRE(pReadB->GetFlowInputs()[0]->GetFlowData() == pA->pOut->GetFlowData());
+    REQUIRE(pA->pOut->GetReaderCount() == 2);
+    REQUIRE(static_cast<CountFlowData*>(pReadA->pOut->GetFlowData())->value == 3);
+    REQUIRE(static_cast<CountFlowData*>(pReadB->pOut->GetFlowData())->value == 3);
+
+    // Split, the duplicate computes into a buffer of its own, and its reader reads that
+    pB->pOffset->Set(1.0f, true);
+    g.Compute(roots, 1);
+    REQUIRE(pB->computeCount == 1);
+    REQUIRE(pA->pOut->GetReaderCount() == 1);
+    REQUIRE(pB->pOut->GetFlowData() != nullptr);
+    REQUIRE(pA->pOut->GetFlowData() != pB->pOut->GetFlowData());
+    REQUIRE(pReadB->GetFlowInputs()[0]->GetFlowData() == pB->pOut->GetFlowData());
+    REQUIRE(static_cast<CountFlowData*>(pReadA->pOut->GetFlowData())->value == 3);
+    REQUIRE(static_cast<CountFlowData*>(pReadB->pOut->GetFlowData())->value == 4);
+}
+
+// A pooled node that computes a whole block at once
+class BlockPooledTestNode : public PooledTestNode
+{
+public:
+    using PooledTestNode::PooledTestNode;
+
+    virtual bool IsBlockAware() const override
+    {
+        return true;
+    }
+
+    virtual void ComputeBlock(int64_t, uint32_t) override
+    {
+        Compute();
+    }
+};
+
+TEST_CASE("NodeGraph.FlowPool", "[Plan]")
+{
+    Graph g;
+
+    // A chain only needs two buffers; each is free again once the next node has read it
+    std::vector<PooledTestNode*> chain;
+    for (int index = 0; index < 6; index++)
+    {
+        chain.push_back(g.CreateNode<PooledTestNode>());
+        if (index > 0)
+        {
+            chain[index - 1]->ConnectTo(chain[index], "Out", str_AutoGen);
+        }
+    }
+
+    auto roots = std::vector<Node*>{ chain.back() };
+    g.Compute(roots, 0);
+    REQUIRE(g.GetFlowPool().GetBufferCount() == 2);
+    REQUIRE(chain[0]->pOut->GetFlowData() == chain[2]->pOut->GetFlowData());
+    REQUIRE(chain[0]->pOut->GetFlowData() != chain[1]->pOut->GetFlowData());
+    REQUIRE(static_cast<CountFlowData*>(chain.back()->pOut->GetFlowData())->value == 6);
+
+    SECTION("A second reader keeps the buffer until it has run")
+    {
+        auto pLate = g.CreateNode<PooledTestNode>();
+        chain[0]->ConnectTo(pLate, "Out", str_AutoGen);
+        chain[4]->ConnectTo(pLate, "Out", str_AutoGen);
+
+        g.Compute(std::vector<Node*>{ chain.back(), pLate }, 1);
+        REQUIRE(chain[0]->pOut->GetFlowData() != chain[2]->pOut->GetFlowData());
+        REQUIRE(static_cast<CountFlowData*>(pLate->pOut->GetFlowData())->value == 6);
+    }
+
+    SECTION("In place nodes write over the buffer they read")
+    {
+        for (size_t index = 1; index < chain.size(); index++)
+        {
+            chain[index]->pOut->SetInPlaceInput(chain[index]->GetFlowInputs()[0]);
+        }
+
+        // A second reader of the first buffer stops the second node from writing over it
+        auto pTap = g.CreateNode<PooledTestNode>();
+        chain[0]->ConnectTo(pTap, "Out", str_AutoGen);
+
+        g.Compute(std::vector<Node*>{ chain.back(), pTap }, 1);
+        REQUIRE(chain[1]->pOut->GetFlowData() != chain[0]->pOut->GetFlowData());
+        for (size_t index = 2; index < chain.size(); index++)
+        {
+            REQUIRE(chain[index]->pOut->GetFlowData() == chain[1]->pOut->GetFlowData());
+        }
+        REQUIRE(static_cast<CountFlowData*>(chain.back()->pOut->GetFlowData())->value == 6);
+        REQUIRE(static_cast<CountFlowData*>(pTap->pOut->GetFlowData())->value == 2);
+    }
+
+    SECTION("Stepped nodes keep apart from the rest of the block")
+    {
+        // The block aware source computes first; the stepped nodes then read it at every frame
+        auto pSource = g.CreateNode<BlockPooledTestNode>();
+        auto pStep = g.CreateNode<PooledTestNode>();
+        auto pReader = g.CreateNode<PooledTestNode>();
+        pSource->ConnectTo(pStep, "Out", str_AutoGen);
+        pStep->ConnectTo(pReader, "Out", str_AutoGen);
+
+        // A later node of the block may not take the source's buffer, though its last reader is an earlier level
+        auto pMid = g.CreateNode<BlockPooledTestNode>();
+        auto pLate = g.CreateNode<BlockPooledTestNode>();
+        pSource->ConnectTo(pMid, "Out", str_AutoGen);
+        pMid->ConnectTo(pLate, "Out", str_AutoGen);
+
+        auto stepped = std::vector<Node*>{ pReader, pLate };
+        g.ComputeBlock(stepped, 0, 4);
+        REQUIRE(g.GetPlan(stepped).steppedNodes == std::vector<Node*>{ pStep, pReader });
+        REQUIRE(pReader->pOut->GetFlowData() != pSource->pOut->GetFlowData());
+        REQUIRE(pLate->pOut->GetFlowData() != pSource->pOut->GetFlowData());
+        REQUIRE(static_cast<CountFlowData*>(pLate->pOut->GetFlowData())->value == 3);
+        REQUIRE(static_cast<CountFlowData*>(pSource->pOut->GetFlowData())->value == 1);
+        REQUIRE(static_cast<CountFlowData*>(pStep->pOut->GetFlowData())->value == 2);
+        REQUIRE(static_cast<CountFlowData*>(pReader->pOut->GetFlowData())->value == 3);
+    }
+
+    SECTION("Folded nodes have a buffer of their own")
+    {
+        // A table made from constants, read at the head of the chain
+        auto pTable = g.CreateNode<PureFlowTestNode>();
+        pTable->pValue->Set(7.0f, true);
+        pTable->ConnectTo(chain[0], "Out", str_AutoGen);
+
+        g.Compute(roots, 1);
+        REQUIRE(g.GetPlan(roots).folded == std::vector<Node*>{ pTable });
+        REQUIRE(pTable->pOut->GetFlowData() != nullptr);
+        for (auto& pNode : chain)
+        {
+            REQUIRE(pNode->pOut->GetFlowData() != pTable->pOut->GetFlowData());
+        }
+        REQUIRE(static_cast<CountFlowData*>(chain.back()->pOut->GetFlowData())->value == 13);
+
+        g.Compute(roots, 2);
+        REQUIRE(pTable->computeCount == 1);
+        REQUIRE(static_cast<CountFlowData*>(pTable->pOut->GetFlowData())->value == 7);
+    }
+
+    SECTION("Incremental graphs keep a buffer per output")
+    {
+        g.SetIncremental(true);
+        g.Compute(roots, 1);
+        REQUIRE(g.GetFlowPool().GetBufferCount() == 6);
+        REQUIRE(chain[0]->pOut->GetFlowData() != chain[2]->pOut->GetFlowData());
+    }
+}
+
+// Adds one to its input, where it found it
+class WriterTestNode : public Node
+{
+public:
+    DECLARE_NODE(WriterTestNode, writer);
+
+    WriterTestNode(Graph& m_graph)
+        : Node(m_graph, "Writer")
+    {
+    }
+
+    virtual void Compute() override
+    {
+        pData = static_cast<CountFlowData*>(GetFlowInputs()[0]->WriteFlowData());
+        pData->value++;
+        value = pData->value;
+    }
+
+    CountFlowData* pData = nullptr;
+    int value = 0;
+};
+
+TEST_CASE("NodeGraph.CopyOnWrite", "[Plan]")
+{
+    Graph g;
+    auto pSource = g.CreateNode<PooledTestNode>();
+    std::vector<WriterTestNode*> writers;
+    std::vector<Node*> roots;
+    for (int index = 0; index < 3; index++)
+    {
+        writers.push_back(g.CreateNode<WriterTestNode>());
+        pSource->ConnectTo(writers.back(), "Out", str_AutoGen);
+        roots.push_back(writers.back());
+    }
+
+    // The first two copy; the last has the data to itself
+    g.Compute(roots, 0);
+    auto pShared = static_cast<CountFlowData*>(pSource->pOut->GetFlowData());
+    REQUIRE(writers[0]->pData != pShared);
+    REQUIRE(writers[1]->pData != pShared);
+    REQUIRE(writers[2]->pData == pShared);
+    for (auto& pWriter : writers)
+    {
+        REQUIRE(pWriter->value == 2);
+    }
+
+    SECTION("The copies are kept")
+    {
+        auto pCopy = writers[0]->pData;
+        g.Compute(roots, 1);
+        REQUIRE(writers[0]->pData == pCopy);
+        REQUIRE(writers[0]->value == 2);
+    }
+
+    SECTION("Incremental graphs always copy")
+    {
+        g.SetIncremental(true);
+        g.Compute(roots, 1);
+        REQUIRE(writers[2]->pData != static_cast<CountFlowData*>(pSource->pOut->GetFlowData()));
+        REQUIRE(writers[2]->value == 2);
+    }
+}
+
+struct SampleFlowData : public IFlowData
+{
+    float sample = 0.0f;
+};
+
+class TypedTestNode : public Node
+{
+public:
+    DECLARE_NODE(TypedTestNode, typed);
+
+    TypedTestNode(Graph& m_graph)
+        : Node(m_graph, "Typed")
+    {
+        in = AddFlowInput<SampleFlowData>("In");
+        out = AddPooledFlowOutput<SampleFlowData>("Out");
+    }
+
+    virtual void Compute() override
+    {
+        auto pIn = in.Read();
+        out.Read()->sample = pIn ? pIn->sample + 1.0f : 1.0f;
+    }
+
+    FlowPin<SampleFlowData> in;
+    FlowPin<SampleFlowData> out;
+};
+
+TEST_CASE("NodeGraph.TypedFlow", "[Nodes]")
+{
+    Graph g;
+    auto pA = g.CreateNode<TypedTestNode>();
+    auto pB = g.CreateNode<TypedTestNode>();
+    pA->ConnectTo(pB, "Out", "In");
+
+    // Pooled typed outputs are always given buffers of their payload type
+    REQUIRE(pA->out.GetPin()->GetFlowAllocator() == &CreateFlowData<SampleFlowData>);
+
+    g.Compute(std::vector<Node*>{ pB }, 0);
+    REQUIRE(pB->out.Read()->sample == 2.0f);
+
+    // A typed input refuses untyped outputs, and other payloads
+    auto pPooled = g.CreateNode<PooledTestNode>();
+    REQUIRE_THROWS_AS(pPooled->ConnectTo(pA, "Out", "In"), std::invalid_argument);
+    REQUIRE(pA->in.GetPin()->GetSource() == nullptr);
+
+    // Untyped inputs take anything
+    auto pUntyped = g.CreateNode<WriterTestNode>();
+    pPooled->ConnectTo(pUntyped, "Out", str_AutoGen);
+    REQUIRE(pUntyped->GetFlowInputs()[0]->AcceptsFlowFrom(*pA->out.GetPin()));
+
+    pPooled->pOut->SetFlowType(ctti::type_id<CountFlowData>().hash());
+    REQUIRE_THROWS_AS(pPooled->ConnectTo(pA, "Out", "In"), std::invalid_argument);
+
+    auto pWriter = g.CreateNode<WriterTestNode>();
+    pA->ConnectTo(pWriter, "Out", str_AutoGen);
+    REQUIRE(pWriter->GetFlowInputs()[0]->GetFlowType() == pA->out.GetPin()->GetFlowType());
+    REQUIRE_THROWS_AS(pPooled->ConnectTo(pWriter, 0, 0), std::invalid_argument);
+}
+
+TEST_CASE("NodeGraph.ChangeQueue", "[Parameters]")
+{
+    Graph g;
+    auto pNode = g.CreateNode<TestNode>();
+    pNode->pValue1->GetAttributes().min = ParameterValue(0.0f);
+    pNode->pValue1->GetAttributes().max = ParameterValue(10.0f);
+
+    // Nothing changes until the graph computes
+    auto& queue = g.GetChangeQueue();
+    REQUIRE(queue.PushNormalized(*pNode->pValue1, 0.5));
+    REQUIRE(queue.Push(*pNode->pValue2, ParameterValue(3.0f)));
+    REQUIRE(pNode->pValue1->To<float>() == 0.0f);
+
+    g.Compute(std::vector<Node*>{ pNode }, 0);
+    REQUIRE(queue.Empty());
+    REQUIRE(pNode->pValue1->To<float>() == 5.0f);
+    REQUIRE(pNode->pSum->To<float>() == 8.0f);
+
+    SECTION("A full queue drops the change")
+    {
+        ParameterChangeQueue small(2);
+        REQUIRE(small.Push(*pNode->pValue2, ParameterValue(1.0f)));
+        REQUIRE(small.Push(*pNode->pValue2, ParameterValue(2.0f)));
+        REQUIRE_FALSE(small.Push(*pNode->pValue2, ParameterValue(4.0f)));
+        REQUIRE(small.Drain() == 2);
+        REQUIRE(pNode->pValue2->To<float>() == 2.0f);
+    }
+
+    SECTION("Edits from another thread arrive in order")
+    {
+        ParameterChangeQueue small(4);
+        std::thread producer([&]() {
+            for (int64_t value = 1; value <= 1000; value++)
+            {
+                while (!small.Push(*pNode->pValue2, ParameterValue(float(value))))
+                {
+                    std::this_thread::yield();
+                }
+            }
+        });
+
+        float last = 0.0f;
+        bool ordered = true;
+        while (last != 1000.0f)
+        {
+            small.Drain();
+            ordered = ordered && pNode->pValue2->To<float>() >= last;
+            last = pNode->pValue2->To<float>();
+        }
+        producer.join();
+        REQUIRE(ordered);
+    }
+
+    SECTION("Edits to destroyed nodes are dropped")
+    {
+        auto pOther = g.CreateNode<TestNode>();
+        REQUIRE(queue.Push(*pNode->pValue2, ParameterValue(4.0f)));
+        REQUIRE(queue.Push(*pOther->pValue2, ParameterValue(6.0f)));
+        g.DestroyNode(pNode);
+
+        // The new node may sit in the destroyed one's memory; the edit must not reach it
+        auto pNew = g.CreateNode<TestNode>();
+        REQUIRE(queue.Drain() == 1);
+        REQUIRE(pOther->pValue2->To<float>() == 6.0f);
+        REQUIRE(pNew->pValue2->To<float>() == 0.0f);
+    }
+
+    SECTION("Destroying the graph drops every edit")
+    {
+        REQUIRE(queue.Push(*pNode->pValue2, ParameterValue(4.0f)));
+        g.Destroy();
+        REQUIRE(queue.Empty());
+
+        auto pNew = g.CreateNode<TestNode>();
+        g.Compute(std::vector<Node*>{ pNew }, 1);
+        REQUIRE(pNew->pValue2->To<float>() == 0.0f);
+    }
+}
+
+// Burns a fixed amount of CPU, standing in for a DSP node
+class WorkTestNode : public Node
+{
+public:
+    DECLARE_NODE(WorkTestNode, work);
+
+    WorkTestNode(Graph& m_graph)
+        : Node(m_graph, "Work")
+    {
+        pOut = AddOutput("Out", (IFlowData*)nullptr);
+    }
+
+    virtual void Compute() override
+    {
+        for (int i = 0; i < 2000; i++)
+        {
+            result = std::sin(result + float(i));
+        }
+    }
+
+    Pin* pOut = nullptr;
+    float result = 0.0f;
+};
+
+TEST_CASE("NodeGraph.SchedulerScaling", "[!benchmark]")
+{
+    // Branches of uneven length off a single source, joined at the end
+    Graph g;
+    auto pSource = g.CreateNode<WorkTestNode>();
+    auto pSink = g.CreateNode<WorkTestNode>();
+    for (int branch = 0; branch < 32; branch++)
+    {
+        Node* pPrevious = pSource;
+        for (int length = 0; length < 1 + (branch * 7) % 12; length++)
+        {
+            auto pNode = g.CreateNode<WorkTestNode>();
+            pPrevious->ConnectTo(pNode, "Out", str_AutoGen);
+            pPrevious = pNode;
+        }
+        pPrevious->ConnectTo(pSink, "Out", str_AutoGen);
+    }
+
+    std::vector<Node*> roots{ pSink };
+    int64_t tick = 0;
+
+    g.SetComputeMode(ComputeMode::Sequential);
+    BENCHMARK("Sequential")
+    {
+        g.Compute(roots, tick++);
+    };
+
+    g.SetComputeMode(ComputeMode::WorkStealing);
+    for (uint32_t threads = 1; threads <= std::max(std::thread::hardware_concurrency(), 1u); threads++)
+    {
+        g.SetComputeThreads(threads);
+        BENCHMARK("WorkStealing x" + std::to_string(threads))
+        {
+            g.Compute(roots, tick++);
+        };
+    }
+}
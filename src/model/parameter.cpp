@@ -0,0 +1,232 @@
+#include <mutex>
+#include <unordered_map>
+
+#include "nodegraph/model/parameter.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define NODEGRAPH_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace NodeGraph
+{
+
+namespace
+{
+void HashCombine(size_t& seed, size_t value)
+{
+    seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
+struct AttributeTable
+{
+    std::mutex lock;
+    std::unordered_multimap<size_t, std::weak_ptr<ParameterAttributes>> entries;
+};
+
+AttributeTable& GetAttributeTable()
+{
+    static AttributeTable table;
+    return table;
+}
+
+#ifdef NODEGRAPH_SSE2
+void StoreLerp(float* pValues, __m128 start, __m128 delta, __m128 frac)
+{
+    _mm_storeu_ps(pValues, _mm_add_ps(start, _mm_mul_ps(delta, frac)));
+}
+
+void StoreLerp(double* pValues, __m128d start, __m128d delta, __m128 frac)
+{
+    _mm_storeu_pd(pValues, _mm_add_pd(start, _mm_mul_pd(delta, _mm_cvtps_pd(frac))));
+    _mm_storeu_pd(pValues + 2, _mm_add_pd(start, _mm_mul_pd(delta, _mm_cvtps_pd(_mm_movehl_ps(frac, frac)))));
+}
+
+__m128 Splat(float value)
+{
+    return _mm_set1_ps(value);
+}
+
+__m128d Splat(double value)
+{
+    return _mm_set1_pd(value);
+}
+#endif
+
+// Values of a lerp from start to end over [startTick, startTick + lerpTicks), for [tick, tick + count).
+// The fraction is worked out in float, as ValueAt does
+template <class T>
+void RenderLerp(T start, T end, int64_t startTick, int64_t lerpTicks, int64_t tick, T* pValues, uint32_t count)
+{
+    // Flat before the ramp begins and after it ends
+    auto rampBegin = uint32_t(std::clamp<int64_t>(startTick - tick, 0, count));
+    auto rampEnd = uint32_t(std::clamp<int64_t>(startTick + lerpTicks - tick, rampBegin, count));
+    std::fill(pValues, pValues + rampBegin, start);
+    std::fill(pValues + rampEnd, pValues + count, end);
+
+    auto delta = end - start;
+    auto lerpTicksF = float(lerpTicks);
+    auto index = rampBegin;
+
+#ifdef NODEGRAPH_SSE2
+    const auto vStart = Splat(start);
+    const auto vDelta = Splat(delta);
+    const auto vLerpTicks = _mm_set1_ps(lerpTicksF);
+    const auto vFour = _mm_set1_ps(4.0f);
+    auto elapsed = _mm_add_ps(_mm_set1_ps(float(tick + index - startTick)), _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f));
+    for (; index + 4 <= rampEnd; index += 4)
+    {
+        StoreLerp(pValues + index, vStart, vDelta, _mm_div_ps(elapsed, vLerpTicks));
+        elapsed = _mm_add_ps(elapsed, vFour);
+    }
+#endif
+
+    for (; index < rampEnd; index++)
+    {
+        auto frac = float(tick + index - startTick) / lerpTicksF;
+        pValues[index] = T(start + delta * frac);
+    }
+}
+
+// Any other type, or a buffer of another type, a frame at a time
+template <class T>
+void RenderParameter(const Parameter& param, int64_t tick, T* pValues, uint32_t count)
+{
+    for (uint32_t index = 0; index < count; index++)
+    {
+        pValues[index] = param.ValueAt<T>(tick + index);
+    }
+}
+} // namespace
+
+size_t ParameterValue::Hash() const
+{
+    size_t seed = std::hash<int>()(int(type));
+    switch (type)
+    {
+    case ParameterType::Float:
+        HashCombine(seed, std::hash<float>()(fVal));
+        break;
+    case ParameterType::Double:
+        HashCombine(seed, std::hash<double>()(dVal));
+        break;
+    case ParameterType::Int64:
+        HashCombine(seed, std::hash<int64_t>()(iVal));
+        break;
+    case ParameterType::Bool:
+        HashCombine(seed, std::hash<bool>()(bVal));
+        break;
+    case ParameterType::String:
+        HashCombine(seed, std::hash<std::string>()(sVal));
+        break;
+    case ParameterType::FlowData:
+        HashCombine(seed, std::hash<void*>()(pFVal));
+        break;
+    case ParameterType::ControlData:
+        HashCombine(seed, std::hash<void*>()(pCVal));
+        break;
+    default:
+        break;
+    }
+    return seed;
+}
+
+size_t ParameterAttributes::Hash() const
+{
+    size_t seed = std::hash<int>()(int(ui));
+    HashCombine(seed, min.Hash());
+    HashCombine(seed, max.Hash());
+    HashCombine(seed, origin.Hash());
+    HashCombine(seed, step.Hash());
+    HashCombine(seed, thumb.Hash());
+    HashCombine(seed, std::hash<bool>()(multiSelect));
+    HashCombine(seed, std::hash<int>()(int(displayType)));
+    HashCombine(seed, std::hash<std::string>()(postFix));
+    HashCombine(seed, std::hash<uint32_t>()(flags));
+    HashCombine(seed, std::hash<float>()(taper));
+    for (auto& label : labels)
+    {
+        HashCombine(seed, std::hash<std::string>()(label));
+    }
+    return seed;
+}
+
+std::shared_ptr<ParameterAttributes> ParameterAttributeTable::Intern(const ParameterAttributes& attributes)
+{
+    auto hash = attributes.Hash();
+
+    auto& table = GetAttributeTable();
+    std::lock_guard<std::mutex> guard(table.lock);
+
+    auto range = table.entries.equal_range(hash);
+    for (auto itr = range.first; itr != range.second;)
+    {
+        auto spExisting = itr->second.lock();
+        if (!spExisting)
+        {
+            // Nobody uses it any more
+            itr = table.entries.erase(itr);
+            continue;
+        }
+
+        if (*spExisting == attributes)
+        {
+            return spExisting;
+        }
+        itr++;
+    }
+
+    auto spAttributes = std::make_shared<ParameterAttributes>(attributes);
+    table.entries.emplace(hash, spAttributes);
+    return spAttributes;
+}
+
+size_t ParameterAttributeTable::Size()
+{
+    auto& table = GetAttributeTable();
+    std::lock_guard<std::mutex> guard(table.lock);
+
+    size_t count = 0;
+    for (auto& entry : table.entries)
+    {
+        if (!entry.second.expired())
+        {
+            count++;
+        }
+    }
+    return count;
+}
+
+void Parameter::RenderRamp(int64_t tick, float* pValues, uint32_t count) const
+{
+    if (!IsRamping())
+    {
+        std::fill(pValues, pValues + count, To<float>());
+    }
+    else if (m_type == ParameterType::Float && m_lerpTicks != 0)
+    {
+        RenderLerp(m_startValue.fVal, m_endValue.fVal, m_startTick, m_lerpTicks, tick, pValues, count);
+    }
+    else
+    {
+        RenderParameter(*this, tick, pValues, count);
+    }
+}
+
+void Parameter::RenderRamp(int64_t tick, double* pValues, uint32_t count) const
+{
+    if (!IsRamping())
+    {
+        std::fill(pValues, pValues + count, To<double>());
+    }
+    else if (m_type == ParameterType::Double && m_lerpTicks != 0)
+    {
+        RenderLerp(m_startValue.dVal, m_endValue.dVal, m_startTick, m_lerpTicks, tick, pValues, count);
+    }
+    else
+    {
+        RenderParameter(*this, tick, pValues, count);
+    }
+}
+
+} // namespace NodeGraph
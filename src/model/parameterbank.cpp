@@ -0,0 +1,364 @@
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+#include "mutils/profile/profile.h"
+
+#include "nodegraph/model/parameter.h"
+#include "nodegraph/model/parameterbank.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define NODEGRAPH_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace NodeGraph
+{
+
+namespace
+{
+// Same snap distance as Parameter::Update, for both types
+const float SnapEpsilon = std::numeric_limits<float>::epsilon();
+
+double Fraction(double tick, double startTick, double invLerpTicks)
+{
+    return std::max(0.0, std::min(1.0, (tick - startTick) * invLerpTicks));
+}
+
+template <class T>
+T Lerp(T start, T end, double frac)
+{
+    T value = start + (end - start) * T(frac);
+    return std::abs(value - end) <= SnapEpsilon ? end : value;
+}
+} // namespace
+
+template <class T>
+void ParameterBank::Lanes<T>::Resize(size_t size)
+{
+    start.resize(size);
+    end.resize(size);
+    current.resize(size);
+    startTick.resize(size);
+    invLerpTicks.resize(size);
+    params.resize(size);
+}
+
+template <class T>
+void ParameterBank::Lanes<T>::Remove(uint32_t slot)
+{
+    // Swap the last lane into the hole
+    auto last = uint32_t(params.size() - 1);
+    params[slot]->m_bankSlot = InactiveSlot;
+    if (slot != last)
+    {
+        start[slot] = start[last];
+        end[slot] = end[last];
+        current[slot] = current[last];
+        startTick[slot] = startTick[last];
+        invLerpTicks[slot] = invLerpTicks[last];
+        params[slot] = params[last];
+        params[slot]->m_bankSlot = slot;
+    }
+    Resize(last);
+}
+
+ParameterBank::ParameterBank()
+{
+}
+
+ParameterBank::~ParameterBank()
+{
+    assert(GetActiveCount() == 0);
+}
+
+template <class T>
+void ParameterBank::Fill(Lanes<T>& lanes, uint32_t slot, Parameter& param)
+{
+    lanes.start[slot] = ParameterTraits<T>::Ref(param.m_startValue);
+    lanes.end[slot] = ParameterTraits<T>::Ref(param.m_endValue);
+    lanes.current[slot] = ParameterTraits<T>::Ref(param.m_value);
+    if (param.m_lerpTicks != 0)
+    {
+        lanes.startTick[slot] = double(param.m_startTick);
+        lanes.invLerpTicks[slot] = 1.0 / double(param.m_lerpTicks);
+    }
+    else
+    {
+        // No ramp; always at the end
+        lanes.startTick[slot] = -std::numeric_limits<double>::infinity();
+        lanes.invLerpTicks[slot] = 1.0;
+    }
+}
+
+template <class T>
+void ParameterBank::Activate(Lanes<T>& lanes, Parameter& param)
+{
+    param.m_bankSlot = uint32_t(lanes.params.size());
+    lanes.Resize(param.m_bankSlot + 1);
+    lanes.params[param.m_bankSlot] = &param;
+    Fill(lanes, param.m_bankSlot, param);
+}
+
+void ParameterBank::Add(Parameter& param)
+{
+    if (param.m_pBank)
+    {
+        return;
+    }
+    param.m_pBank = this;
+    SetRamp(param);
+}
+
+void ParameterBank::Remove(Parameter& param)
+{
+    assert(param.m_pBank == this);
+    std::lock_guard<std::mutex> guard(m_lock);
+    if (param.m_bankSlot != InactiveSlot)
+    {
+        if (param.m_type == ParameterType::Float)
+        {
+            m_floats.Remove(param.m_bankSlot);
+        }
+        else if (param.m_type == ParameterType::Double)
+        {
+            m_doubles.Remove(param.m_bankSlot);
+        }
+        else
+        {
+            auto last = m_others.back();
+            m_others[param.m_bankSlot] = last;
+            last->m_bankSlot = param.m_bankSlot;
+            m_others.pop_back();
+            param.m_bankSlot = InactiveSlot;
+        }
+    }
+    param.m_pBank = nullptr;
+}
+
+void ParameterBank::SetRamp(Parameter& param)
+{
+    assert(param.m_pBank == this);
+
+    // Nothing to do until a lerp starts
+    if (param.m_bankSlot == InactiveSlot && !param.IsRamping())
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> guard(m_lock);
+    if (param.m_type == ParameterType::Float)
+    {
+        if (param.m_bankSlot == InactiveSlot)
+        {
+            Activate(m_floats, param);
+        }
+        else
+        {
+            Fill(m_floats, param.m_bankSlot, param);
+        }
+    }
+    else if (param.m_type == ParameterType::Double)
+    {
+        if (param.m_bankSlot == InactiveSlot)
+        {
+            Activate(m_doubles, param);
+        }
+        else
+        {
+            Fill(m_doubles, param.m_bankSlot, param);
+        }
+    }
+    else if (param.m_bankSlot == InactiveSlot)
+    {
+        // Update reads the ramp straight from the parameter
+        param.m_bankSlot = uint32_t(m_others.size());
+        m_others.push_back(&param);
+    }
+}
+
+void ParameterBank::Update(int64_t tick)
+{
+    MUtilsZoneScoped;
+
+    m_tick = tick;
+    UpdateFloats(tick);
+    UpdateDoubles(tick);
+    UpdateOthers(tick);
+}
+
+template <class T>
+void ParameterBank::Scatter(Parameter& param, T value, int64_t tick)
+{
+    // The parameter may have been updated directly, in which case it already has this value
+    auto& paramValue = ParameterTraits<T>::Ref(param.m_value);
+    if (paramValue != value)
+    {
+        paramValue = value;
+        param.m_generation++;
+    }
+    param.m_currentTick = tick;
+}
+
+template <class T>
+void ParameterBank::Retire(Lanes<T>& lanes)
+{
+    // Highest first, so the lanes swapped into the holes are never ones still to retire
+    for (auto itr = m_retired.rbegin(); itr != m_retired.rend(); itr++)
+    {
+        lanes.Remove(*itr);
+    }
+    m_retired.clear();
+}
+
+void ParameterBank::UpdateFloats(int64_t tick)
+{
+    auto& lanes = m_floats;
+    auto count = lanes.params.size();
+    auto dTick = double(tick);
+    size_t index = 0;
+
+#ifdef NODEGRAPH_SSE2
+    const auto zero = _mm_setzero_pd();
+    const auto one = _mm_set1_pd(1.0);
+    const auto ticks = _mm_set1_pd(dTick);
+    const auto epsilon = _mm_set1_ps(SnapEpsilon);
+    const auto absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    for (; index + 4 <= count; index += 4)
+    {
+        // Fractions in double, so large tick counts keep their precision
+        auto fracLo = _mm_mul_pd(_mm_sub_pd(ticks, _mm_loadu_pd(&lanes.startTick[index])), _mm_loadu_pd(&lanes.invLerpTicks[index]));
+        auto fracHi = _mm_mul_pd(_mm_sub_pd(ticks, _mm_loadu_pd(&lanes.startTick[index + 2])), _mm_loadu_pd(&lanes.invLerpTicks[index + 2]));
+        fracLo = _mm_max_pd(zero, _mm_min_pd(one, fracLo));
+        fracHi = _mm_max_pd(zero, _mm_min_pd(one, fracHi));
+        auto frac = _mm_movelh_ps(_mm_cvtpd_ps(fracLo), _mm_cvtpd_ps(fracHi));
+
+        auto start = _mm_loadu_ps(&lanes.start[index]);
+        auto end = _mm_loadu_ps(&lanes.end[index]);
+        auto value = _mm_add_ps(start, _mm_mul_ps(_mm_sub_ps(end, start), frac));
+
+        // Snap onto the end value when close enough
+        auto snap = _mm_cmple_ps(_mm_and_ps(_mm_sub_ps(value, end), absMask), epsilon);
+        value = _mm_or_ps(_mm_and_ps(snap, end), _mm_andnot_ps(snap, value));
+
+        auto current = _mm_loadu_ps(&lanes.current[index]);
+        auto changed = _mm_movemask_ps(_mm_cmpneq_ps(value, current));
+        auto done = _mm_movemask_ps(_mm_cmpeq_ps(value, end));
+        if ((changed | done) == 0)
+        {
+            continue;
+        }
+
+        _mm_storeu_ps(&lanes.current[index], value);
+        for (int lane = 0; lane < 4; lane++)
+        {
+            if (changed & (1 << lane))
+            {
+                Scatter(*lanes.params[index + lane], lanes.current[index + lane], tick);
+            }
+            if (done & (1 << lane))
+            {
+                m_retired.push_back(uint32_t(index + lane));
+            }
+        }
+    }
+#endif
+
+    for (; index < count; index++)
+    {
+        auto value = Lerp(lanes.start[index], lanes.end[index], Fraction(dTick, lanes.startTick[index], lanes.invLerpTicks[index]));
+        if (value != lanes.current[index])
+        {
+            lanes.current[index] = value;
+            Scatter(*lanes.params[index], value, tick);
+        }
+        if (value == lanes.end[index])
+        {
+            m_retired.push_back(uint32_t(index));
+        }
+    }
+    Retire(lanes);
+}
+
+void ParameterBank::UpdateDoubles(int64_t tick)
+{
+    auto& lanes = m_doubles;
+    auto count = lanes.params.size();
+    auto dTick = double(tick);
+    size_t index = 0;
+
+#ifdef NODEGRAPH_SSE2
+    const auto zero = _mm_setzero_pd();
+    const auto one = _mm_set1_pd(1.0);
+    const auto ticks = _mm_set1_pd(dTick);
+    const auto epsilon = _mm_set1_pd(SnapEpsilon);
+    const auto absMask = _mm_castsi128_pd(_mm_set1_epi64x(0x7fffffffffffffffll));
+    for (; index + 2 <= count; index += 2)
+    {
+        auto frac = _mm_mul_pd(_mm_sub_pd(ticks, _mm_loadu_pd(&lanes.startTick[index])), _mm_loadu_pd(&lanes.invLerpTicks[index]));
+        frac = _mm_max_pd(zero, _mm_min_pd(one, frac));
+
+        auto start = _mm_loadu_pd(&lanes.start[index]);
+        auto end = _mm_loadu_pd(&lanes.end[index]);
+        auto value = _mm_add_pd(start, _mm_mul_pd(_mm_sub_pd(end, start), frac));
+
+        auto snap = _mm_cmple_pd(_mm_and_pd(_mm_sub_pd(value, end), absMask), epsilon);
+        value = _mm_or_pd(_mm_and_pd(snap, end), _mm_andnot_pd(snap, value));
+
+        auto current = _mm_loadu_pd(&lanes.current[index]);
+        auto changed = _mm_movemask_pd(_mm_cmpneq_pd(value, current));
+        auto done = _mm_movemask_pd(_mm_cmpeq_pd(value, end));
+        if ((changed | done) == 0)
+        {
+            continue;
+        }
+
+        _mm_storeu_pd(&lanes.current[index], value);
+        for (int lane = 0; lane < 2; lane++)
+        {
+            if (changed & (1 << lane))
+            {
+                Scatter(*lanes.params[index + lane], lanes.current[index + lane], tick);
+            }
+            if (done & (1 << lane))
+            {
+                m_retired.push_back(uint32_t(index + lane));
+            }
+        }
+    }
+#endif
+
+    for (; index < count; index++)
+    {
+        auto value = Lerp(lanes.start[index], lanes.end[index], Fraction(dTick, lanes.startTick[index], lanes.invLerpTicks[index]));
+        if (value != lanes.current[index])
+        {
+            lanes.current[index] = value;
+            Scatter(*lanes.params[index], value, tick);
+        }
+        if (value == lanes.end[index])
+        {
+            m_retired.push_back(uint32_t(index));
+        }
+    }
+    Retire(lanes);
+}
+
+void ParameterBank::UpdateOthers(int64_t tick)
+{
+    for (size_t index = m_others.size(); index > 0; index--)
+    {
+        auto pParam = m_others[index - 1];
+        pParam->Update(tick);
+        if (!pParam->IsRamping())
+        {
+            auto pLast = m_others.back();
+            m_others[index - 1] = pLast;
+            pLast->m_bankSlot = uint32_t(index - 1);
+            m_others.pop_back();
+            pParam->m_bankSlot = InactiveSlot;
+        }
+    }
+}
+
+} // namespace NodeGraph
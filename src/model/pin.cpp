@@ -2,6 +2,7 @@
 #include <stdexcept>
 
 #include "mutils/logger/logger.h"
+#include "nodegraph/model/graph.h"
 #include "nodegraph/model/pin.h"
 #include "nodegraph/model/node.h"
 
@@ -17,6 +18,7 @@ Pin::Pin(Node& o, PinDir pinDir, const std::string& pinName, float val, const Pa
     , m_direction(pinDir)
     , m_strName(pinName)
 {
+    o.GetGraph().GetParameterBank().Add(*this);
 }
 
 Pin::Pin(Node& o, PinDir pinDir, const std::string& pinName, double val, const ParameterAttributes& attribs)
@@ -25,6 +27,7 @@ Pin::Pin(Node& o, PinDir pinDir, const std::string& pinName, double val, const P
     , m_direction(pinDir)
     , m_strName(pinName)
 {
+    o.GetGraph().GetParameterBank().Add(*this);
 }
 
 Pin::Pin(Node& o, PinDir pinDir, const std::string& pinName, int64_t val, const ParameterAttributes& attribs)
@@ -33,6 +36,7 @@ Pin::Pin(Node& o, PinDir pinDir, const std::string& pinName, int64_t val, const
     , m_direction(pinDir)
     , m_strName(pinName)
 {
+    o.GetGraph().GetParameterBank().Add(*this);
 }
 
 Pin::Pin(Node& o, PinDir pinDir, const std::string& pinName, bool val, const ParameterAttributes& attribs)
@@ -41,6 +45,7 @@ Pin::Pin(Node& o, PinDir pinDir, const std::string& pinName, bool val, const Par
     , m_direction(pinDir)
     , m_strName(pinName)
 {
+    o.GetGraph().GetParameterBank().Add(*this);
 }
 
 Pin::Pin(Node& o, PinDir pinDir, const std::string& pinName, IFlowData* val, const ParameterAttributes& attribs)
@@ -49,6 +54,7 @@ Pin::Pin(Node& o, PinDir pinDir, const std::string& pinName, IFlowData* val, con
     , m_direction(pinDir)
     , m_strName(pinName)
 {
+    o.GetGraph().GetParameterBank().Add(*this);
 }
 
 Pin::Pin(Node& o, PinDir pinDir, const std::string& pinName, IControlData* val, const ParameterAttributes& attribs)
@@ -57,6 +63,7 @@ Pin::Pin(Node& o, PinDir pinDir, const std::string& pinName, IControlData* val,
     , m_direction(pinDir)
     , m_strName(pinName)
 {
+    o.GetGraph().GetParameterBank().Add(*this);
 }
 
 
@@ -66,6 +73,7 @@ Pin::Pin(Node& o, PinDir pinDir, const std::string& pinName, const std::string&
     , m_direction(pinDir)
     , m_strName(pinName)
 {
+    o.GetGraph().GetParameterBank().Add(*this);
 }
 
 Pin::Pin(Node& o, PinDir pinDir, const std::string& pinName, const Parameter& param)
@@ -74,6 +82,45 @@ Pin::Pin(Node& o, PinDir pinDir, const std::string& pinName, const Parameter& pa
     , m_direction(pinDir)
     , m_strName(pinName)
 {
+    o.GetGraph().GetParameterBank().Add(*this);
+}
+
+IFlowData* Pin::WriteFlowData()
+{
+    assert(m_type == ParameterType::FlowData && m_direction == PinDir::Input);
+    auto pData = GetFlowData();
+    if (m_pSource == nullptr || pData == nullptr)
+    {
+        return pData;
+    }
+
+    // Only this reader is left; nobody else will see the change
+    if (GetProducer()->m_pendingReaders.load(std::memory_order_acquire) == 1)
+    {
+        return pData;
+    }
+
+    if (m_spFlowCopy)
+    {
+        m_spFlowCopy->CopyFrom(*pData);
+    }
+    else
+    {
+        m_spFlowCopy = pData->Clone();
+        if (!m_spFlowCopy)
+        {
+            throw std::invalid_argument("Flow data can't be copied");
+        }
+    }
+    return m_spFlowCopy.get();
+}
+
+void Pin::SetInPlaceInput(Pin* pInput)
+{
+    assert(m_fnCreateFlow != nullptr);
+    assert(pInput == nullptr || (&pInput->GetOwnerNode() == &m_owner && pInput->GetType() == ParameterType::FlowData && pInput->GetDirection() == PinDir::Input));
+    m_pInPlaceInput = pInput;
+    m_owner.GetGraph().InvalidatePlan();
 }
 
 } // namespace NodeGraph
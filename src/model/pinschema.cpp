@@ -0,0 +1,43 @@
+#include "nodegraph/model/pinschema.h"
+
+namespace NodeGraph
+{
+
+namespace
+{
+template <class T>
+ParameterAttributes SpecAttributes(const PinSpec& spec)
+{
+    if (spec.ui == ParameterUI::None)
+    {
+        return ParameterAttributes{};
+    }
+    return ParameterAttributes(spec.ui, T(spec.min), T(spec.max));
+}
+} // namespace
+
+std::unique_ptr<Parameter> MakePinPrototype(const PinSpec& spec)
+{
+    switch (spec.type)
+    {
+    case ParameterType::Float:
+        return std::make_unique<Parameter>(float(spec.value), SpecAttributes<float>(spec));
+    case ParameterType::Double:
+        return std::make_unique<Parameter>(spec.value, SpecAttributes<double>(spec));
+    case ParameterType::Int64:
+        return std::make_unique<Parameter>(int64_t(spec.value), SpecAttributes<int64_t>(spec));
+    case ParameterType::Bool:
+        return std::make_unique<Parameter>(spec.value != 0.0, SpecAttributes<bool>(spec));
+    case ParameterType::String:
+        return std::make_unique<Parameter>(std::string(), ParameterAttributes{});
+    case ParameterType::FlowData:
+        return std::make_unique<Parameter>((IFlowData*)nullptr);
+    case ParameterType::ControlData:
+        return std::make_unique<Parameter>((IControlData*)nullptr);
+    default:
+        break;
+    }
+    throw std::invalid_argument("Pin schema entry has no type");
+}
+
+} // namespace NodeGraph
@@ -0,0 +1,733 @@
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "nodegraph/model/node.h"
+#include "nodegraph/model/pin.h"
+#include "nodegraph/model/plan.h"
+
+namespace NodeGraph
+{
+
+namespace
+{
+void HashCombine(size_t& seed, size_t value)
+{
+    seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
+// Candidates for merging: pure, and not about to drift apart through a ramp on one of their constants
+bool IsMergeable(const Node& node)
+{
+    if ((node.GetFlags() & (NodeFlags::Pure | NodeFlags::Volatile)) != NodeFlags::Pure || node.GetOutputs().empty())
+    {
+        return false;
+    }
+
+    auto& inputs = node.GetInputs();
+    return std::none_of(inputs.begin(), inputs.end(), [](Pin* pInput) {
+        return pInput->GetSource() == nullptr && pInput->IsRamping();
+    });
+}
+
+// Point the readers of a duplicate's outputs at the same outputs of its survivor
+void MergeReaders(ExecutionPlan& plan, const ExecutionPlan::Merge& merge)
+{
+    auto& outputs = merge.pSurvivor->GetOutputs();
+    auto& duplicateOutputs = merge.pDuplicate->GetOutputs();
+    for (size_t index = 0; index < outputs.size(); index++)
+    {
+        for (auto& pTarget : duplicateOutputs[index]->GetTargets())
+        {
+            pTarget->ResolveTo(*outputs[index]);
+            plan.mergedReaders.push_back(pTarget);
+        }
+    }
+}
+
+// Find the duplicates among the planned nodes, and take them out of it.  Sources are compared after merging,
+// so the readers of two duplicates are themselves duplicates
+void MergeDuplicates(ExecutionPlan& plan)
+{
+    std::unordered_map<Node*, Node*> survivors;
+
+    // The pin a source really is; an output of the survivor if its node was merged
+    auto canonical = [&](const Pin* pPin) -> std::pair<Node*, size_t> {
+        auto pOwner = &pPin->GetOwnerNode();
+        auto& outputs = pOwner->GetOutputs();
+        auto index = size_t(std::find(outputs.begin(), outputs.end(), pPin) - outputs.begin());
+        auto itr = survivors.find(pOwner);
+        return std::make_pair(itr == survivors.end() ? pOwner : itr->second, index);
+    };
+
+    auto sameInputs = [&](Node& left, Node& right) {
+        auto& leftInputs = left.GetInputs();
+        auto& rightInputs = right.GetInputs();
+        if (left.GetType() != right.GetType() || leftInputs.size() != rightInputs.size())
+        {
+            return false;
+        }
+
+        for (size_t index = 0; index < leftInputs.size(); index++)
+        {
+            auto pLeftSource = leftInputs[index]->GetSource();
+            auto pRightSource = rightInputs[index]->GetSource();
+            if ((pLeftSource == nullptr) != (pRightSource == nullptr))
+            {
+                return false;
+            }
+
+            if (pLeftSource ? canonical(pLeftSource) != canonical(pRightSource) : !(leftInputs[index]->GetParameterValue() == rightInputs[index]->GetParameterValue()))
+            {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    std::unordered_multimap<size_t, Node*> classes;
+    auto recordInputs = [&](ExecutionPlan::Merge& merge, Node* pNode) {
+        for (auto& pInput : pNode->GetInputs())
+        {
+            if (pInput->GetSource() == nullptr)
+            {
+                merge.inputs.push_back(pInput);
+            }
+            else if (survivors.count(&pInput->GetSource()->GetOwnerNode()) != 0)
+            {
+                merge.via.push_back(&pInput->GetSource()->GetOwnerNode());
+            }
+        }
+    };
+
+    for (auto& pNode : plan.nodes)
+    {
+        if (!IsMergeable(*pNode))
+        {
+            continue;
+        }
+
+        size_t hash = size_t(pNode->GetType().hash());
+        for (auto& pInput : pNode->GetInputs())
+        {
+            if (pInput->GetSource())
+            {
+                auto source = canonical(pInput->GetSource());
+                HashCombine(hash, std::hash<Node*>()(source.first));
+                HashCombine(hash, source.second);
+            }
+            else
+            {
+                HashCombine(hash, pInput->GetParameterValue().Hash());
+            }
+        }
+
+        auto range = classes.equal_range(hash);
+        auto itr = std::find_if(range.first, range.second, [&](auto& entry) {
+            return sameInputs(*entry.second, *pNode);
+        });
+
+        if (itr == range.second)
+        {
+            classes.emplace(hash, pNode);
+            continue;
+        }
+
+        auto pSurvivor = itr->second;
+        survivors[pNode] = pSurvivor;
+        if (plan.duplicates.size() <= pSurvivor->GetIndex())
+        {
+            plan.duplicates.resize(pSurvivor->GetIndex() + 1);
+        }
+        plan.duplicates[pSurvivor->GetIndex()].push_back(pNode);
+
+        ExecutionPlan::Merge merge{ pSurvivor, pNode, {}, 0, {} };
+        recordInputs(merge, pSurvivor);
+        recordInputs(merge, pNode);
+        merge.stamp = InputStamp(merge.inputs);
+        plan.merges.push_back(std::move(merge));
+    }
+
+    for (auto& merge : plan.merges)
+    {
+        MergeReaders(plan, merge);
+    }
+
+    if (!survivors.empty())
+    {
+        plan.nodes.erase(std::remove_if(plan.nodes.begin(), plan.nodes.end(), [&](Node* pNode) {
+            return survivors.count(pNode) != 0;
+        }), plan.nodes.end());
+    }
+}
+
+// Levels, batches and edges for plan.nodes, which must be in an order where sources come first
+void ScheduleNodes(ExecutionPlan& plan, std::unordered_map<Node*, size_t>& levels)
+{
+    plan.levelStarts.clear();
+    plan.batchStarts.clear();
+    plan.levelBatches.clear();
+    plan.dependencyCounts.clear();
+    plan.successorStarts.clear();
+    plan.successors.clear();
+
+    // Edges from folded nodes don't order anything; their outputs are ready before the schedule runs.
+    // The readers of a merged node read its survivor, so no edge leads to one
+    std::unordered_set<Node*> folded(plan.folded.begin(), plan.folded.end());
+    auto sourceNode = [](const Pin& pin) {
+        return &pin.GetProducer()->GetOwnerNode();
+    };
+    auto isScheduledDependency = [&](const Pin& pin) {
+        return IsDependencyPin(pin) && folded.count(sourceNode(pin)) == 0;
+    };
+
+    // A node's level is one more than the deepest of its sources, so everything in a level is independent
+    levels.clear();
+    size_t levelCount = 0;
+    for (auto& pNode : plan.nodes)
+    {
+        size_t level = 0;
+        for (auto& pInput : pNode->GetInputs())
+        {
+            if (isScheduledDependency(*pInput))
+            {
+                level = std::max(level, levels[sourceNode(*pInput)] + 1);
+            }
+        }
+        levels[pNode] = level;
+        levelCount = std::max(levelCount, level + 1);
+    }
+
+    // Nodes that can be batched are grouped by type; the rest keep the key 0
+    std::unordered_map<Node*, uint64_t> batchKeys;
+    for (auto& pNode : plan.nodes)
+    {
+        batchKeys[pNode] = pNode->GetComputeBatch() ? pNode->GetType().hash() : 0;
+    }
+
+    // Level order is also a valid topological order; stable so that the walk order is kept within a level
+    std::stable_sort(plan.nodes.begin(), plan.nodes.end(), [&](Node* pLeft, Node* pRight) {
+        auto leftLevel = levels[pLeft];
+        auto rightLevel = levels[pRight];
+        if (leftLevel != rightLevel)
+        {
+            return leftLevel < rightLevel;
+        }
+        return batchKeys[pLeft] < batchKeys[pRight];
+    });
+
+    // A node that isn't block aware leaves its readers only the last frame of a block.  It, and everything
+    // downstream of it, steps a frame at a time; in level order, so a node's sources are decided before it
+    std::unordered_set<Node*> stepped;
+    for (auto& pNode : plan.nodes)
+    {
+        for (auto& pInput : pNode->GetInputs())
+        {
+            if (isScheduledDependency(*pInput) && !sourceNode(*pInput)->IsBlockAware())
+            {
+                stepped.insert(sourceNode(*pInput));
+            }
+        }
+    }
+
+    plan.steppedNodes.clear();
+    plan.stepped.clear();
+    for (auto& pNode : plan.nodes)
+    {
+        auto& inputs = pNode->GetInputs();
+        if (stepped.count(pNode) != 0 || std::any_of(inputs.begin(), inputs.end(), [&](Pin* pInput) {
+            return isScheduledDependency(*pInput) && stepped.count(sourceNode(*pInput)) != 0;
+        }))
+        {
+            stepped.insert(pNode);
+            plan.steppedNodes.push_back(pNode);
+            if (plan.stepped.size() <= pNode->GetIndex())
+            {
+                plan.stepped.resize(pNode->GetIndex() + 1, 0);
+            }
+            plan.stepped[pNode->GetIndex()] = 1;
+        }
+    }
+
+    plan.levelStarts.resize(levelCount + 1, plan.nodes.size());
+    for (size_t index = plan.nodes.size(); index > 0; index--)
+    {
+        plan.levelStarts[levels[plan.nodes[index - 1]]] = index - 1;
+    }
+
+    // A batch ends at a level boundary, or where the type changes; unbatched nodes are a batch each
+    size_t level = 0;
+    for (size_t index = 0; index < plan.nodes.size(); index++)
+    {
+        bool levelStart = index == plan.levelStarts[level];
+        if (levelStart)
+        {
+            plan.levelBatches.push_back(plan.batchStarts.size());
+            level++;
+        }
+
+        auto key = batchKeys[plan.nodes[index]];
+        if (levelStart || key == 0 || key != batchKeys[plan.nodes[index - 1]])
+        {
+            plan.batchStarts.push_back(index);
+        }
+    }
+    plan.batchStarts.push_back(plan.nodes.size());
+    plan.levelBatches.push_back(plan.batchStarts.size() - 1);
+
+    // Flatten the edges; one entry per connected input, so counts and successors always agree
+    std::unordered_map<Node*, uint32_t> indices;
+    for (uint32_t index = 0; index < uint32_t(plan.nodes.size()); index++)
+    {
+        indices[plan.nodes[index]] = index;
+    }
+
+    plan.dependencyCounts.resize(plan.nodes.size(), 0);
+    plan.successorStarts.resize(plan.nodes.size() + 1, 0);
+    for (auto& pNode : plan.nodes)
+    {
+        for (auto& pInput : pNode->GetInputs())
+        {
+            if (isScheduledDependency(*pInput))
+            {
+                plan.dependencyCounts[indices[pNode]]++;
+                plan.successorStarts[indices[sourceNode(*pInput)] + 1]++;
+            }
+        }
+    }
+
+    for (size_t index = 0; index < plan.nodes.size(); index++)
+    {
+        plan.successorStarts[index + 1] += plan.successorStarts[index];
+    }
+
+    auto fill = std::vector<uint32_t>(plan.successorStarts.begin(), plan.successorStarts.end() - 1);
+    plan.successors.resize(plan.successorStarts.back());
+    for (auto& pNode : plan.nodes)
+    {
+        for (auto& pInput : pNode->GetInputs())
+        {
+            if (isScheduledDependency(*pInput))
+            {
+                plan.successors[fill[indices[sourceNode(*pInput)]]++] = indices[pNode];
+            }
+        }
+    }
+}
+
+// Linear scan over the levels, as in register allocation.  A buffer is free once the level of its last reader
+// has finished, and can go to an output made in any later level.  An output read from outside the schedule, or
+// by nothing (the caller may want it), keeps its buffer; as do folded nodes, which only compute now and then.
+// An output that may work in place takes over its input's buffer, when it is the only reader of it.
+// Stepped nodes compute after the rest of the block, so the two never share buffers, and an output read by
+// a stepped node keeps its buffer
+void AssignFlowBuffers(ExecutionPlan& plan, std::unordered_map<Node*, size_t>& levels)
+{
+    constexpr size_t Forever = std::numeric_limits<size_t>::max();
+
+    struct Retiring
+    {
+        const Pin* pOutput;
+        size_t lastLevel;
+        fnCreateFlowData fnCreate;
+        uint32_t buffer;
+        bool stepped;
+    };
+    std::vector<Retiring> retiring;
+    std::unordered_map<fnCreateFlowData, std::vector<uint32_t>> freeBuffers[2];    // Apart for stepped nodes
+    std::unordered_map<fnCreateFlowData, uint32_t> bufferCounts;
+
+    auto isStepped = [&](const Node& node) {
+        return node.GetIndex() < plan.stepped.size() && plan.stepped[node.GetIndex()] != 0;
+    };
+
+    // Inputs that read an output in place of a merged duplicate's
+    std::unordered_map<const Pin*, std::vector<Pin*>> mergedReaders;
+    for (auto& pReader : plan.mergedReaders)
+    {
+        mergedReaders[pReader->GetProducer()].push_back(pReader);
+    }
+
+    // The buffer of the input an output may overwrite; only if this is its one reader, and it's the same kind
+    auto inPlaceSource = [&](const Pin& output) {
+        auto pInput = output.GetInPlaceInput();
+        auto pSource = pInput && pInput->GetSource() ? pInput->GetProducer() : nullptr;
+        if (pSource == nullptr || pSource->GetReaderCount() != 1)
+        {
+            return retiring.end();
+        }
+        return std::find_if(retiring.begin(), retiring.end(), [&](const Retiring& entry) {
+            return entry.pOutput == pSource && entry.fnCreate == output.GetFlowAllocator();
+        });
+    };
+
+    for (auto& pNode : plan.folded)
+    {
+        for (auto& pOutput : pNode->GetFlowOutputs())
+        {
+            if (auto fnCreate = pOutput->GetFlowAllocator())
+            {
+                plan.flowBuffers.push_back(ExecutionPlan::FlowBuffer{ pOutput, fnCreate, bufferCounts[fnCreate]++ });
+            }
+        }
+    }
+
+    for (auto& pNode : plan.nodes)
+    {
+        auto level = levels[pNode];
+        auto stepped = isStepped(*pNode);
+
+        // Everything read before this level is done with its buffer
+        if (plan.reuseFlowBuffers)
+        {
+            retiring.erase(std::remove_if(retiring.begin(), retiring.end(), [&](const Retiring& entry) {
+                if (entry.lastLevel >= level)
+                {
+                    return false;
+                }
+                freeBuffers[entry.stepped][entry.fnCreate].push_back(entry.buffer);
+                return true;
+            }), retiring.end());
+        }
+
+        for (auto& pOutput : pNode->GetFlowOutputs())
+        {
+            auto fnCreate = pOutput->GetFlowAllocator();
+            if (fnCreate == nullptr)
+            {
+                continue;
+            }
+
+            auto lastLevel = pOutput->GetReaderCount() == 0 ? Forever : level;
+            auto readBy = [&](const Pin* pReader) {
+                auto itr = levels.find(&pReader->GetOwnerNode());
+                lastLevel = itr == levels.end() || (!stepped && isStepped(pReader->GetOwnerNode())) ? Forever : std::max(lastLevel, itr->second);
+            };
+            for (auto& pTarget : pOutput->GetTargets())
+            {
+                readBy(pTarget);
+            }
+            auto itrMerged = mergedReaders.find(pOutput);
+            if (itrMerged != mergedReaders.end())
+            {
+                for (auto& pReader : itrMerged->second)
+                {
+                    readBy(pReader);
+                }
+            }
+
+            uint32_t buffer;
+            auto& available = freeBuffers[stepped][fnCreate];
+            auto itrSource = plan.reuseFlowBuffers ? inPlaceSource(*pOutput) : retiring.end();
+            if (itrSource != retiring.end())
+            {
+                buffer = itrSource->buffer;
+                retiring.erase(itrSource);
+            }
+            else if (!available.empty())
+            {
+                buffer = available.back();
+                available.pop_back();
+            }
+            else
+            {
+                buffer = bufferCounts[fnCreate]++;
+            }
+
+            plan.flowBuffers.push_back(ExecutionPlan::FlowBuffer{ pOutput, fnCreate, buffer });
+            if (plan.reuseFlowBuffers && lastLevel != Forever)
+            {
+                retiring.push_back(Retiring{ pOutput, lastLevel, fnCreate, buffer, stepped });
+            }
+        }
+    }
+}
+
+// Generations only go up, so the sum changes whenever any one of them does
+template <class Pins>
+uint64_t SumGenerations(const Pins& inputs)
+{
+    uint64_t stamp = 0;
+    for (auto& pInput : inputs)
+    {
+        stamp += pInput->GetGeneration();
+        if (pInput->GetSource())
+        {
+            stamp += pInput->GetProducer()->GetGeneration();
+        }
+    }
+    return stamp;
+}
+} // namespace
+
+bool IsDependencyPin(const Pin& pin)
+{
+    return pin.GetDirection() == PinDir::Input && pin.GetSource() != nullptr && (pin.GetType() == ParameterType::FlowData || pin.GetType() == ParameterType::ControlData);
+}
+
+uint64_t InputStamp(const std::vector<Pin*>& inputs)
+{
+    return SumGenerations(inputs);
+}
+
+uint64_t InputStamp(const std::vector<const Pin*>& inputs)
+{
+    return SumGenerations(inputs);
+}
+
+bool SplitDuplicates(ExecutionPlan& plan)
+{
+    std::unordered_set<Node*> split;
+    for (auto& merge : plan.merges)
+    {
+        if (InputStamp(merge.inputs) != merge.stamp)
+        {
+            split.insert(merge.pDuplicate);
+        }
+    }
+
+    if (split.empty())
+    {
+        return false;
+    }
+
+    // A merge made because both read the same survivor doesn't hold once one of them reads a split node
+    for (bool grew = true; grew;)
+    {
+        grew = false;
+        for (auto& merge : plan.merges)
+        {
+            if (split.count(merge.pDuplicate) == 0 && std::any_of(merge.via.begin(), merge.via.end(), [&](Node* pNode) { return split.count(pNode) != 0; }))
+            {
+                split.insert(merge.pDuplicate);
+                grew = true;
+            }
+        }
+    }
+
+    // In merge order, so a node goes back after the nodes it reads
+    bool reschedule = false;
+    for (auto& merge : plan.merges)
+    {
+        if (split.count(merge.pDuplicate) == 0)
+        {
+            continue;
+        }
+
+        auto& duplicates = plan.duplicates[merge.pSurvivor->GetIndex()];
+        duplicates.erase(std::remove(duplicates.begin(), duplicates.end(), merge.pDuplicate), duplicates.end());
+
+        // The duplicate of a folded node is folded too, just after it, and so ahead of the readers they share
+        auto itrFolded = std::find(plan.folded.begin(), plan.folded.end(), merge.pSurvivor);
+        if (itrFolded != plan.folded.end())
+        {
+            plan.folded.insert(itrFolded + 1, merge.pDuplicate);
+            for (auto& pInput : merge.pDuplicate->GetInputs())
+            {
+                if (pInput->GetSource() == nullptr)
+                {
+                    plan.foldedInputs.push_back(pInput);
+                }
+            }
+        }
+        else
+        {
+            // Just after its survivor, so after its sources, and ahead of the readers it gets back
+            auto itrSurvivor = std::find(plan.nodes.begin(), plan.nodes.end(), merge.pSurvivor);
+            plan.nodes.insert(itrSurvivor + 1, merge.pDuplicate);
+            reschedule = true;
+        }
+    }
+
+    plan.merges.erase(std::remove_if(plan.merges.begin(), plan.merges.end(), [&](const ExecutionPlan::Merge& merge) {
+        return split.count(merge.pDuplicate) != 0;
+    }), plan.merges.end());
+
+    // The buffers already handed out stay where they are; a split node's pooled outputs get new ones of their own
+    std::unordered_map<fnCreateFlowData, uint32_t> bufferCounts;
+    for (auto& flow : plan.flowBuffers)
+    {
+        bufferCounts[flow.fnCreate] = std::max(bufferCounts[flow.fnCreate], flow.buffer + 1);
+    }
+
+    // Readers of a split node read it again
+    for (auto& pNode : split)
+    {
+        for (auto& pOutput : pNode->GetOutputs())
+        {
+            for (auto& pTarget : pOutput->GetTargets())
+            {
+                pTarget->Resolve();
+            }
+
+            auto fnCreate = pOutput->GetType() == ParameterType::FlowData ? pOutput->GetFlowAllocator() : nullptr;
+            if (fnCreate)
+            {
+                plan.flowBuffers.push_back(ExecutionPlan::FlowBuffer{ pOutput, fnCreate, bufferCounts[fnCreate]++ });
+            }
+        }
+    }
+    plan.mergedReaders.erase(std::remove_if(plan.mergedReaders.begin(), plan.mergedReaders.end(), [](Pin* pReader) {
+        return pReader->GetProducer() == pReader->GetSource();
+    }), plan.mergedReaders.end());
+
+    if (reschedule)
+    {
+        std::unordered_map<Node*, size_t> levels;
+        ScheduleNodes(plan, levels);
+    }
+    return true;
+}
+
+void RestoreMergedReaders(ExecutionPlan& plan)
+{
+    for (auto& pReader : plan.mergedReaders)
+    {
+        pReader->Resolve();
+    }
+    plan.mergedReaders.clear();
+}
+
+void BuildExecutionPlan(ExecutionPlan& plan, const std::vector<Node*>& roots, uint64_t topologyVersion, bool mergeDuplicates, bool reuseFlowBuffers)
+{
+    RestoreMergedReaders(plan);
+    plan.roots = roots;
+    plan.nodes.clear();
+    plan.levelStarts.clear();
+    plan.batchStarts.clear();
+    plan.levelBatches.clear();
+    plan.dependencyCounts.clear();
+    plan.successorStarts.clear();
+    plan.successors.clear();
+    plan.folded.clear();
+    plan.foldedInputs.clear();
+    plan.duplicates.clear();
+    plan.merges.clear();
+    plan.flowBuffers.clear();
+    plan.reuseFlowBuffers = reuseFlowBuffers;
+    plan.topologyVersion = topologyVersion;
+
+    enum class VisitState
+    {
+        Visiting,
+        Done
+    };
+    std::unordered_map<Node*, VisitState> state;
+
+    // Depth first, post order walk of the sources; with an explicit stack so that long chains don't recurse
+    struct StackEntry
+    {
+        Node* pNode;
+        size_t nextInput;
+    };
+    std::vector<StackEntry> stack;
+
+    for (auto& pRoot : roots)
+    {
+        if (state.find(pRoot) != state.end())
+        {
+            continue;
+        }
+
+        state[pRoot] = VisitState::Visiting;
+        stack.push_back(StackEntry{ pRoot, 0 });
+
+        while (!stack.empty())
+        {
+            auto& entry = stack.back();
+            auto& inputs = entry.pNode->GetInputs();
+
+            Node* pSourceNode = nullptr;
+            while (entry.nextInput < inputs.size() && pSourceNode == nullptr)
+            {
+                auto pInput = inputs[entry.nextInput++];
+                if (!IsDependencyPin(*pInput))
+                {
+                    continue;
+                }
+
+                auto pCandidate = &pInput->GetSource()->GetOwnerNode();
+                auto itr = state.find(pCandidate);
+                if (itr == state.end())
+                {
+                    pSourceNode = pCandidate;
+                }
+                else
+                {
+                    // A node still on the stack means a cycle; there is no valid order for it
+                    assert(itr->second == VisitState::Done);
+                }
+            }
+
+            if (pSourceNode)
+            {
+                state[pSourceNode] = VisitState::Visiting;
+                stack.push_back(StackEntry{ pSourceNode, 0 });
+                continue;
+            }
+
+            // All sources are placed, so this node can go next.  Settle where its inputs read from while here
+            for (auto& pInput : inputs)
+            {
+                pInput->Resolve();
+            }
+            state[entry.pNode] = VisitState::Done;
+            plan.nodes.push_back(entry.pNode);
+            stack.pop_back();
+        }
+    }
+
+    // Folding sees a merged node as its survivor, since that is what its readers now read
+    if (mergeDuplicates)
+    {
+        MergeDuplicates(plan);
+    }
+
+    auto sourceNode = [](const Pin& pin) {
+        return &pin.GetProducer()->GetOwnerNode();
+    };
+
+    // Fold the pure nodes that only read constants or other folded nodes.  In walk order, so sources are decided
+    // first; a source that isn't in the plan, or comes later, is never folded, and keeps the reader in the schedule
+    std::unordered_set<Node*> folded;
+    for (auto& pNode : plan.nodes)
+    {
+        if ((pNode->GetFlags() & (NodeFlags::Pure | NodeFlags::Volatile)) != NodeFlags::Pure)
+        {
+            continue;
+        }
+
+        auto& inputs = pNode->GetInputs();
+        bool constant = std::all_of(inputs.begin(), inputs.end(), [&](Pin* pInput) {
+            return pInput->GetSource() == nullptr || folded.count(sourceNode(*pInput)) != 0;
+        });
+
+        if (constant)
+        {
+            folded.insert(pNode);
+            plan.folded.push_back(pNode);
+            for (auto& pInput : inputs)
+            {
+                if (pInput->GetSource() == nullptr)
+                {
+                    plan.foldedInputs.push_back(pInput);
+                }
+            }
+        }
+    }
+
+    if (!folded.empty())
+    {
+        plan.nodes.erase(std::remove_if(plan.nodes.begin(), plan.nodes.end(), [&](Node* pNode) {
+            return folded.count(pNode) != 0;
+        }), plan.nodes.end());
+    }
+
+    std::unordered_map<Node*, size_t> levels;
+    ScheduleNodes(plan, levels);
+    AssignFlowBuffers(plan, levels);
+}
+
+} // namespace NodeGraph
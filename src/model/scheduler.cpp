@@ -0,0 +1,210 @@
+#include <algorithm>
+#include <thread>
+
+#include "nodegraph/model/node.h"
+#include "nodegraph/model/plan.h"
+#include "nodegraph/model/scheduler.h"
+
+namespace NodeGraph
+{
+
+// A deque of plan indices; the owner pushes and pops at the bottom, thieves take from the top.
+// Every node is pushed at most once per run, so a buffer the size of the plan never overflows.
+class WorkStealingScheduler::WorkDeque
+{
+public:
+    void Reset(size_t capacity)
+    {
+        m_items.resize(capacity);
+        m_top = 0;
+        m_bottom = 0;
+    }
+
+    void Push(uint32_t index)
+    {
+        Lock();
+        m_items[m_bottom++] = index;
+        Unlock();
+    }
+
+    bool Pop(uint32_t& index)
+    {
+        Lock();
+        bool found = m_bottom != m_top;
+        if (found)
+        {
+            index = m_items[--m_bottom];
+        }
+        Unlock();
+        return found;
+    }
+
+    bool Steal(uint32_t& index)
+    {
+        Lock();
+        bool found = m_bottom != m_top;
+        if (found)
+        {
+            index = m_items[m_top++];
+        }
+        Unlock();
+        return found;
+    }
+
+private:
+    // The critical sections are a few instructions, so spin rather than sleep
+    void Lock()
+    {
+        while (m_lock.test_and_set(std::memory_order_acquire))
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    void Unlock()
+    {
+        m_lock.clear(std::memory_order_release);
+    }
+
+private:
+    std::atomic_flag m_lock = ATOMIC_FLAG_INIT;
+    std::vector<uint32_t> m_items;
+    size_t m_top = 0;
+    size_t m_bottom = 0;
+};
+
+WorkStealingScheduler::WorkStealingScheduler()
+{
+}
+
+WorkStealingScheduler::~WorkStealingScheduler()
+{
+}
+
+void WorkStealingScheduler::Prepare(const ExecutionPlan& plan, uint32_t threads)
+{
+    auto nodeCount = plan.nodes.size();
+    if (m_pendingCapacity < nodeCount)
+    {
+        m_pendingInputs = std::make_unique<std::atomic<uint32_t>[]>(nodeCount);
+        m_pendingCapacity = nodeCount;
+    }
+
+    while (m_deques.size() < threads)
+    {
+        m_deques.push_back(std::make_unique<WorkDeque>());
+    }
+
+    m_workerCount = threads;
+    for (uint32_t worker = 0; worker < threads; worker++)
+    {
+        m_deques[worker]->Reset(nodeCount);
+    }
+
+    // Deal the nodes with no inputs out to the workers, so they all start busy
+    uint32_t nextWorker = 0;
+    for (uint32_t index = 0; index < uint32_t(nodeCount); index++)
+    {
+        m_pendingInputs[index].store(plan.dependencyCounts[index], std::memory_order_relaxed);
+        if (plan.dependencyCounts[index] == 0)
+        {
+            m_deques[nextWorker]->Push(index);
+            nextWorker = (nextWorker + 1) % threads;
+        }
+    }
+
+    m_remaining.store(nodeCount);
+    m_abort.store(false);
+    m_spException = nullptr;
+}
+
+bool WorkStealingScheduler::Acquire(uint32_t worker, uint32_t& index)
+{
+    if (m_deques[worker]->Pop(index))
+    {
+        return true;
+    }
+
+    for (uint32_t offset = 1; offset < m_workerCount; offset++)
+    {
+        if (m_deques[(worker + offset) % m_workerCount]->Steal(index))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingScheduler::WorkerLoop(uint32_t worker, const ExecutionPlan& plan, const fnCompute& fn)
+{
+    uint32_t index;
+    while (m_remaining.load(std::memory_order_acquire) != 0 && !m_abort.load(std::memory_order_relaxed))
+    {
+        if (!Acquire(worker, index))
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        try
+        {
+            fn(*plan.nodes[index]);
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> guard(m_exceptionLock);
+            m_spException = std::current_exception();
+            m_abort.store(true);
+        }
+
+        // The last producer to finish makes the consumer ready; keep it local, it reads what we just wrote
+        for (auto successor = plan.successorStarts[index]; successor < plan.successorStarts[index + 1]; successor++)
+        {
+            auto target = plan.successors[successor];
+            if (m_pendingInputs[target].fetch_sub(1, std::memory_order_acq_rel) == 1)
+            {
+                m_deques[worker]->Push(target);
+            }
+        }
+
+        m_remaining.fetch_sub(1, std::memory_order_acq_rel);
+    }
+}
+
+void WorkStealingScheduler::Run(const ExecutionPlan& plan, TPool& pool, uint32_t threads, const fnCompute& fn)
+{
+    if (plan.nodes.empty())
+    {
+        return;
+    }
+
+    threads = std::max(1u, std::min(threads, uint32_t(plan.nodes.size())));
+
+    Prepare(plan, threads);
+
+    m_runningWorkers.store(threads - 1);
+    for (uint32_t worker = 1; worker < threads; worker++)
+    {
+        pool.enqueue([this, worker, &plan, &fn]() {
+            WorkerLoop(worker, plan, fn);
+            m_runningWorkers--;
+        });
+    }
+
+    WorkerLoop(0, plan, fn);
+
+    // The workers reference the plan and callback, so they must all be out before we return
+    while (m_runningWorkers.load() != 0)
+    {
+        std::this_thread::yield();
+    }
+
+    if (m_spException)
+    {
+        auto spException = m_spException;
+        m_spException = nullptr;
+        std::rethrow_exception(spException);
+    }
+}
+
+} // namespace NodeGraph
@@ -1,4 +1,5 @@
 #include <map>
+#include <utility>
 
 #include "nodegraph/view/graphview.h"
 #include "nodegraph/view/viewnode.h"
@@ -109,7 +110,7 @@ bool GraphView::CheckCapture(Parameter& param, const NRectf& region, bool& hover
     if ((m_pCaptureParam == &param) || (overParam && m_pCaptureParam == nullptr))
     {
         hover = true;
-        if (param.GetAttributes().flags & ParameterFlags::ReadOnly)
+        if (std::as_const(param).GetAttributes().flags & ParameterFlags::ReadOnly)
         {
             m_pCaptureParam = nullptr;
         }
@@ -132,7 +133,7 @@ void GraphView::EvaluateDragDelta(Pin& param, float rangePerDelta, InputDirectio
         return;
     }
 
-    const auto& attrib = param.GetAttributes();
+    const auto& attrib = std::as_const(param).GetAttributes();
     const double fMin = 0.0;
     const double fMax = 1.0;
     const double fRange = fMax - fMin;
@@ -151,7 +152,7 @@ void GraphView::EvaluateDragDelta(Pin& param, float rangePerDelta, InputDirectio
     {
         if (fStep == 0.0)
         {
-            fStep = std::abs(1.0 / (param.GetAttributes().max.To<double>() - param.GetAttributes().min.To<double>()));
+            fStep = std::abs(1.0 / (std::as_const(param).GetAttributes().max.To<double>() - std::as_const(param).GetAttributes().min.To<double>()));
             fStep += std::numeric_limits<double>::epsilon();
         }
     }
@@ -167,14 +168,14 @@ void GraphView::EvaluateDragDelta(Pin& param, float rangePerDelta, InputDirectio
 
         if (fNew != startValue)
         {
-            param.SetFromNormalized(fNew);
+            m_graph.GetChangeQueue().PushNormalized(param, fNew);
         }
     }
 }
 
 void GraphView::CheckInput(Pin& param, const NRectf& region, float rangePerDelta, bool& hover, bool& captured, InputDirection dir)
 {
-    const auto& attrib = param.GetAttributes();
+    const auto& attrib = std::as_const(param).GetAttributes();
     if (param.GetSource() == nullptr)
     {
         captured = CheckCapture(param, region, hover);
@@ -213,7 +214,7 @@ void GraphView::DrawLabel(Parameter& param, const LabelInfo& info)
     {
         // Convert to 100% if necessary
         float fVal = param.To<float>();
-        if (param.GetAttributes().displayType == ParameterDisplayType::Percentage && param.GetAttributes().max.To<float>() <= 1.0f)
+        if (std::as_const(param).GetAttributes().displayType == ParameterDisplayType::Percentage && std::as_const(param).GetAttributes().max.To<float>() <= 1.0f)
         {
             fVal *= 100.0f;
             val = std::to_string((int)fVal);
@@ -228,13 +229,13 @@ void GraphView::DrawLabel(Parameter& param, const LabelInfo& info)
         val = std::to_string(param.To<int64_t>());
     }
 
-    switch (param.GetAttributes().displayType)
+    switch (std::as_const(param).GetAttributes().displayType)
     {
     case ParameterDisplayType::Percentage:
         val += "%";
         break;
     case ParameterDisplayType::Custom:
-        val += param.GetAttributes().postFix;
+        val += std::as_const(param).GetAttributes().postFix;
         break;
     case ParameterDisplayType::None:
         return;
@@ -281,7 +282,7 @@ bool GraphView::DrawKnob(NVec2f pos, float knobSize, Pin& param)
     float fontSize = 24.0f * (knobSize / 120.0f);
 
     auto& label = param.GetName();
-    auto& attrib = param.GetAttributes();
+    const auto& attrib = std::as_const(param).GetAttributes();
 
     // Normalized value 0->1
     float fCurrentVal = (float)param.Normalized();
@@ -347,7 +348,7 @@ bool GraphView::DrawKnob(NVec2f pos, float knobSize, Pin& param)
         m_canvas.FilledCircle(pos, knobSize + node_shadowSize, shadowColor);
     }
 
-    if (param.GetAttributes().flags & ParameterFlags::ReadOnly)
+    if (std::as_const(param).GetAttributes().flags & ParameterFlags::ReadOnly)
     {
         color.w = .6f;
         colorHL.w = .6f;
@@ -401,7 +402,7 @@ bool GraphView::DrawKnob(NVec2f pos, float knobSize, Pin& param)
         m_canvas.Text(NVec2f(pos.x, pos.y + knobSize + channelGap + fontSize * 0.5f + 2.0f), fontSize, fontColor, label.c_str());
     }
 
-    if ((captured || hover) && (param.GetAttributes().displayType != ParameterDisplayType::None))
+    if ((captured || hover) && (std::as_const(param).GetAttributes().displayType != ParameterDisplayType::None))
     {
         std::string prefix;
         float offset = knobSize * 2.0f + fontSize * .5f;
@@ -432,7 +433,7 @@ SliderData GraphView::DrawSlider(NRectf region, Pin& param)
     NVec4f markHLColor(1.0f, 1.0f, 1.0f, 1.0f);
     NVec4f fontColor(.8f, .8f, .8f, 1.0f);
 
-    auto& attrib = param.GetAttributes();
+    const auto& attrib = std::as_const(param).GetAttributes();
 
     float fMin = 0.0f;
     float fMax = 1.0f;
@@ -485,7 +486,7 @@ SliderData GraphView::DrawSlider(NRectf region, Pin& param)
 
             auto fQuant = std::floor(fNewVal / fStep) * fStep;
 
-            param.SetFromNormalized(fQuant);
+            m_graph.GetChangeQueue().PushNormalized(param, fQuant);
         }
     }
 
@@ -499,7 +500,7 @@ SliderData GraphView::DrawSlider(NRectf region, Pin& param)
 
     ret.thumb = thumbRect;
 
-    if ((captured || hover) && (param.GetAttributes().displayType != ParameterDisplayType::None))
+    if ((captured || hover) && (std::as_const(param).GetAttributes().displayType != ParameterDisplayType::None))
     {
         m_drawLabels[&param] = LabelInfo(NVec2f(thumbRect.Center().x, thumbRect.Top() - node_titleFontSize));
     }
@@ -518,7 +519,7 @@ void GraphView::DrawButton(NRectf region, Pin& param)
     NVec4f markHLColor(1.0f, 1.0f, 1.0f, 1.0f);
     NVec4f fontColor(.8f, .8f, .8f, 1.0f);
 
-    auto& attrib = param.GetAttributes();
+    const auto& attrib = std::as_const(param).GetAttributes();
 
     float fMin = attrib.min.To<float>();
     float fMax = attrib.max.To<float>();
@@ -573,7 +574,7 @@ void GraphView::DrawButton(NRectf region, Pin& param)
                     currentButton |= ((int64_t)1 << i);
                 }
             }
-            param.SetFrom<int64_t>(currentButton);
+            m_graph.GetChangeQueue().Push(param, ParameterValue(currentButton));
         }
 
         auto buttonColor = markColor;
@@ -739,22 +740,22 @@ void GraphView::Show(const NVec2i& displaySize)
                 cellSize.y * pinGrid.Height());
             pinCell.Adjust(node_pinPad, node_pinPad, -node_pinPad, /*-node_borderPad*/ 0.0f);
 
-            if (pInput->GetAttributes().ui == ParameterUI::Knob)
+            if (std::as_const(*pInput).GetAttributes().ui == ParameterUI::Knob)
             {
                 DrawKnob(NVec2f(pinCell.Center().x, pinCell.Center().y), std::min(pinCell.Width(), pinCell.Height()) - node_pinPad * 2.0f, *pInput);
             }
-            else if (pInput->GetAttributes().ui == ParameterUI::Slider)
+            else if (std::as_const(*pInput).GetAttributes().ui == ParameterUI::Slider)
             {
                 pinCell.Adjust(node_pinPad, node_pinPad, -node_pinPad, -node_pinPad);
                 DrawSlider(pinCell, *pInput);
             }
-            else if (pInput->GetAttributes().ui == ParameterUI::Button)
+            else if (std::as_const(*pInput).GetAttributes().ui == ParameterUI::Button)
             {
                 pinCell.Adjust(node_pinPad, node_pinPad, -node_pinPad, -node_pinPad);
                 DrawButton(pinCell, *pInput);
             }
 
-            else if (pInput->GetAttributes().ui == ParameterUI::Custom)
+            else if (std::as_const(*pInput).GetAttributes().ui == ParameterUI::Custom)
             {
                 pinCell.Adjust(node_pinPad, node_pinPad, -node_pinPad, -node_pinPad);
                 pWorld->DrawCustomPin(*this, m_canvas, pinCell, *pInput);